@@ -0,0 +1,413 @@
+#include "corpus_generator.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+#ifdef SEARCH_SERVER_HAVE_POSIX
+#include "bulk_loader.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SEARCH_SERVER_HAVE_TBB
+#include <tbb/global_control.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+struct BenchmarkOptions {
+    CorpusOptions corpus;
+    vector<size_t> scales = {1000, 10000, 50000};
+    vector<int> thread_counts = {1, 2, 4, 8};
+    int repetitions = 3;
+    string format = "json"s;
+    string output_path;
+};
+
+struct BenchmarkResult {
+    string name;
+    size_t documents = 0;
+    int threads = 1;
+    size_t operations = 0;
+    int64_t best_ns = 0;
+    int64_t mean_ns = 0;
+};
+
+struct IndexFootprint {
+    size_t documents = 0;
+    IndexStats stats;
+};
+
+template <typename Number>
+vector<Number> ParseList(const string& text) {
+    vector<Number> values;
+    istringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        values.push_back(static_cast<Number>(stoll(item)));
+    }
+    if (values.empty()) {
+        throw invalid_argument("Empty list: "s + text);
+    }
+    return values;
+}
+
+void PrintUsage(ostream& out) {
+    out << "Usage: search_server_benchmark [options]\n"
+           "  --documents=N[,N...]   corpus sizes to benchmark (default 1000,10000,50000)\n"
+           "  --threads=N[,N...]     thread counts for parallel operations (default 1,2,4,8)\n"
+           "  --vocabulary=N         distinct words in the corpus (default 20000)\n"
+           "  --document-length=N    words per document (default 50)\n"
+           "  --queries=N            queries per run (default 1000)\n"
+           "  --query-length=N       words per query (default 5)\n"
+           "  --zipf=S               Zipf exponent of word frequencies (default 1.0)\n"
+           "  --seed=N               random seed (default 42)\n"
+           "  --repetitions=N        runs per measurement, the best one is reported (default 3)\n"
+           "  --format=json|csv      output format (default json)\n"
+           "  --output=PATH          write results to PATH instead of stdout\n";
+}
+
+BenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const string key = arg.substr(0, eq);
+        const string value = eq == string::npos ? ""s : arg.substr(eq + 1);
+        if (key == "--help"s) {
+            PrintUsage(cout);
+            exit(0);
+        } else if (key == "--documents"s) {
+            options.scales = ParseList<size_t>(value);
+        } else if (key == "--threads"s) {
+            options.thread_counts = ParseList<int>(value);
+        } else if (key == "--vocabulary"s) {
+            options.corpus.vocabulary_size = stoul(value);
+        } else if (key == "--document-length"s) {
+            options.corpus.document_length = stoul(value);
+        } else if (key == "--queries"s) {
+            options.corpus.query_count = stoul(value);
+        } else if (key == "--query-length"s) {
+            options.corpus.query_length = stoul(value);
+        } else if (key == "--zipf"s) {
+            options.corpus.zipf_exponent = stod(value);
+        } else if (key == "--seed"s) {
+            options.corpus.seed = static_cast<uint32_t>(stoul(value));
+        } else if (key == "--repetitions"s) {
+            options.repetitions = max(1, stoi(value));
+        } else if (key == "--format"s) {
+            if (value != "json"s && value != "csv"s) {
+                throw invalid_argument("Unknown format "s + value);
+            }
+            options.format = value;
+        } else if (key == "--output"s) {
+            options.output_path = value;
+        } else {
+            throw invalid_argument("Unknown option "s + arg);
+        }
+    }
+    return options;
+}
+
+// Limits the parallel algorithms to the given number of worker threads.
+class ThreadLimit {
+public:
+    explicit ThreadLimit(int threads)
+#ifdef SEARCH_SERVER_HAVE_TBB
+        : control_(tbb::global_control::max_allowed_parallelism, static_cast<size_t>(threads))
+#endif
+    {
+        (void)threads;
+    }
+
+private:
+#ifdef SEARCH_SERVER_HAVE_TBB
+    tbb::global_control control_;
+#endif
+};
+
+// Runs setup() + body(state) the requested number of times and keeps the timing of body only.
+template <typename Setup, typename Body>
+BenchmarkResult Measure(const string& name, size_t documents, int threads, size_t operations,
+                        int repetitions, Setup setup, Body body) {
+    BenchmarkResult result{name, documents, threads, operations, numeric_limits<int64_t>::max(), 0};
+    int64_t total_ns = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        decltype(auto) state = setup();
+        const auto start = chrono::steady_clock::now();
+        body(state);
+        const auto duration = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        result.best_ns = min<int64_t>(result.best_ns, duration);
+        total_ns += duration;
+    }
+    result.mean_ns = total_ns / repetitions;
+    cerr << name << " documents="s << documents << " threads="s << threads
+         << " ns/op="s << result.best_ns / static_cast<int64_t>(max<size_t>(operations, 1)) << endl;
+    return result;
+}
+
+#ifdef SEARCH_SERVER_HAVE_POSIX
+string WriteTsvCorpus(const Corpus& corpus) {
+    const string path = (filesystem::temp_directory_path() / "search_server_benchmark.tsv"s).string();
+    ofstream out(path);
+    for (const GeneratedDocument& document : corpus.documents) {
+        out << document.id << '\t' << static_cast<int>(document.status) << '\t';
+        for (size_t i = 0; i < document.ratings.size(); ++i) {
+            out << (i > 0 ? " "s : ""s) << document.ratings[i];
+        }
+        out << '\t' << document.text << '\n';
+    }
+    if (!out) {
+        throw runtime_error("Cannot write "s + path);
+    }
+    return path;
+}
+#endif
+
+SearchServer BuildServer(const Corpus& corpus) {
+    SearchServer server(corpus.stop_words);
+    for (const GeneratedDocument& document : corpus.documents) {
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    return server;
+}
+
+// Applies rewrite to every plus word, e.g. to turn queries into prefix queries
+template <typename Rewrite>
+vector<string> RewritePlusWords(const vector<string>& queries, Rewrite rewrite) {
+    vector<string> result;
+    result.reserve(queries.size());
+    for (const string& query : queries) {
+        string rewritten;
+        for (const string& word : SplitIntoWords(query)) {
+            rewritten += (rewritten.empty() ? ""s : " "s) + (word[0] == '-' ? word : rewrite(word));
+        }
+        result.push_back(move(rewritten));
+    }
+    return result;
+}
+
+void RunScale(const BenchmarkOptions& options, size_t document_count, vector<BenchmarkResult>& results,
+              vector<IndexFootprint>& footprints) {
+    CorpusOptions corpus_options = options.corpus;
+    corpus_options.document_count = document_count;
+    const Corpus corpus = GenerateCorpus(corpus_options);
+    const size_t query_count = corpus.queries.size();
+    const int repetitions = options.repetitions;
+
+    auto empty_server = [&corpus] { return SearchServer(corpus.stop_words); };
+    auto built_server = [&corpus] { return BuildServer(corpus); };
+
+    results.push_back(Measure("AddDocument"s, document_count, 1, document_count, repetitions, empty_server,
+        [&corpus](SearchServer& server) {
+            for (const GeneratedDocument& document : corpus.documents) {
+                server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        }));
+
+#ifdef SEARCH_SERVER_HAVE_POSIX
+    const string tsv_path = WriteTsvCorpus(corpus);
+    results.push_back(Measure("LoadDocuments/tsv"s, document_count, static_cast<int>(BulkLoadOptions{}.worker_count),
+        document_count, repetitions, empty_server,
+        [&tsv_path](SearchServer& server) {
+            LoadDocuments(server, tsv_path);
+        }));
+    filesystem::remove(tsv_path);
+#endif
+
+    const SearchServer server = BuildServer(corpus);
+    footprints.push_back({document_count, server.GetStats().index});
+    auto shared_server = [&server]() -> const SearchServer& { return server; };
+    size_t checksum = 0;
+
+    results.push_back(Measure("FindTopDocuments/seq"s, document_count, 1, query_count, repetitions, shared_server,
+        [&](const SearchServer& server) {
+            for (const string& query : corpus.queries) {
+                checksum += server.FindTopDocuments(execution::seq, query).size();
+            }
+        }));
+
+    results.push_back(Measure("FindTopDocuments/bm25"s, document_count, 1, query_count, repetitions, shared_server,
+        [&](const SearchServer& server) {
+            for (const string& query : corpus.queries) {
+                checksum += server.FindTopDocuments(Bm25Scoring{}, query).size();
+            }
+        }));
+
+    const vector<string> prefix_queries = RewritePlusWords(corpus.queries, [](const string& word) {
+        return word.substr(0, max<size_t>(2, word.size() / 2)) + '*';
+    });
+    results.push_back(Measure("FindTopDocuments/prefix"s, document_count, 1, query_count, repetitions, shared_server,
+        [&](const SearchServer& server) {
+            for (const string& query : prefix_queries) {
+                checksum += server.FindTopDocuments(query).size();
+            }
+        }));
+
+    const vector<string> fuzzy_queries = RewritePlusWords(corpus.queries, [](const string& word) {
+        return word + "~1"s;
+    });
+    results.push_back(Measure("FindTopDocuments/fuzzy"s, document_count, 1, query_count, repetitions, shared_server,
+        [&](const SearchServer& server) {
+            for (const string& query : fuzzy_queries) {
+                checksum += server.FindTopDocuments(query).size();
+            }
+        }));
+
+    results.push_back(Measure("MatchDocument/seq"s, document_count, 1, query_count, repetitions, shared_server,
+        [&](const SearchServer& server) {
+            for (size_t i = 0; i < query_count; ++i) {
+                checksum += get<0>(server.MatchDocument(execution::seq, corpus.queries[i],
+                                                        corpus.documents[i % document_count].id)).size();
+            }
+        }));
+
+    for (const int threads : options.thread_counts) {
+        ThreadLimit limit(threads);
+
+        results.push_back(Measure("FindTopDocuments/par"s, document_count, threads, query_count, repetitions, shared_server,
+            [&](const SearchServer& server) {
+                for (const string& query : corpus.queries) {
+                    checksum += server.FindTopDocuments(execution::par, query).size();
+                }
+            }));
+
+        results.push_back(Measure("MatchDocument/par"s, document_count, threads, query_count, repetitions, shared_server,
+            [&](const SearchServer& server) {
+                for (size_t i = 0; i < query_count; ++i) {
+                    checksum += get<0>(server.MatchDocument(execution::par, corpus.queries[i],
+                                                            corpus.documents[i % document_count].id)).size();
+                }
+            }));
+
+        results.push_back(Measure("ProcessQueries"s, document_count, threads, query_count, repetitions, shared_server,
+            [&](const SearchServer& server) {
+                checksum += ProcessQueries(server, corpus.queries).size();
+            }));
+
+        // the same queries run one by one, as ProcessQueries did before batching
+        results.push_back(Measure("ProcessQueries/independent"s, document_count, threads, query_count, repetitions, shared_server,
+            [&](const SearchServer& server) {
+                vector<vector<Document>> documents(corpus.queries.size());
+                transform(execution::par, corpus.queries.begin(), corpus.queries.end(), documents.begin(),
+                    [&server](const string& query) {
+                        return server.FindTopDocuments(query);
+                    });
+                checksum += documents.size();
+            }));
+    }
+
+    results.push_back(Measure("RemoveDocument"s, document_count, 1, document_count, repetitions, built_server,
+        [&corpus](SearchServer& server) {
+            for (const GeneratedDocument& document : corpus.documents) {
+                server.RemoveDocument(document.id);
+            }
+        }));
+
+    results.push_back(Measure("RemoveDuplicates"s, document_count, 1, document_count, repetitions, built_server,
+        [](SearchServer& server) {
+            // RemoveDuplicates reports every removed document to cout
+            ostringstream sink;
+            auto* old_buffer = cout.rdbuf(sink.rdbuf());
+            RemoveDuplicates(server);
+            cout.rdbuf(old_buffer);
+        }));
+
+    // keeps the optimizer from dropping the query loops
+    if (checksum == numeric_limits<size_t>::max()) {
+        cerr << checksum << endl;
+    }
+}
+
+void PrintJson(ostream& out, const BenchmarkOptions& options, const vector<BenchmarkResult>& results,
+               const vector<IndexFootprint>& footprints) {
+    const CorpusOptions& corpus = options.corpus;
+    out << "{\"config\": {"s
+        << "\"vocabulary\": "s << corpus.vocabulary_size
+        << ", \"document_length\": "s << corpus.document_length
+        << ", \"queries\": "s << corpus.query_count
+        << ", \"query_length\": "s << corpus.query_length
+        << ", \"zipf\": "s << corpus.zipf_exponent
+        << ", \"seed\": "s << corpus.seed
+        << ", \"repetitions\": "s << options.repetitions
+        << ", \"hardware_threads\": "s << thread::hardware_concurrency()
+        << ", \"term_frequency_bytes\": "s << sizeof(TermFrequency)
+        << "},\n\"index\": [\n"s;
+    for (size_t i = 0; i < footprints.size(); ++i) {
+        const IndexStats& stats = footprints[i].stats;
+        out << "  {\"documents\": "s << footprints[i].documents
+            << ", \"vocabulary\": "s << stats.vocabulary_size
+            << ", \"postings\": "s << stats.posting_count
+            << ", \"word_to_document_freqs_bytes\": "s << stats.word_to_document_freqs_bytes
+            << ", \"id_to_word_freqs_bytes\": "s << stats.id_to_word_freqs_bytes
+            << '}' << (i + 1 == footprints.size() ? "\n"s : ",\n"s);
+    }
+    out << "],\n\"results\": [\n"s;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << "  {\"name\": \""s << result.name << '"'
+            << ", \"documents\": "s << result.documents
+            << ", \"threads\": "s << result.threads
+            << ", \"operations\": "s << result.operations
+            << ", \"best_ns\": "s << result.best_ns
+            << ", \"mean_ns\": "s << result.mean_ns
+            << ", \"ns_per_op\": "s << result.best_ns / static_cast<int64_t>(max<size_t>(result.operations, 1))
+            << '}' << (i + 1 == results.size() ? "\n"s : ",\n"s);
+    }
+    out << "]}\n"s;
+}
+
+void PrintCsv(ostream& out, const vector<BenchmarkResult>& results) {
+    out << "name,documents,threads,operations,best_ns,mean_ns,ns_per_op\n"s;
+    for (const BenchmarkResult& result : results) {
+        out << result.name << ',' << result.documents << ',' << result.threads << ',' << result.operations << ','
+            << result.best_ns << ',' << result.mean_ns << ','
+            << result.best_ns / static_cast<int64_t>(max<size_t>(result.operations, 1)) << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const BenchmarkOptions options = ParseOptions(argc, argv);
+
+        vector<BenchmarkResult> results;
+        vector<IndexFootprint> footprints;
+        for (const size_t scale : options.scales) {
+            RunScale(options, scale, results, footprints);
+        }
+
+        ofstream file;
+        if (!options.output_path.empty()) {
+            file.open(options.output_path);
+            if (!file) {
+                throw runtime_error("Cannot open "s + options.output_path);
+            }
+        }
+        ostream& out = options.output_path.empty() ? cout : file;
+        if (options.format == "csv"s) {
+            PrintCsv(out, results);
+        } else {
+            PrintJson(out, options, results, footprints);
+        }
+    } catch (const exception& e) {
+        cerr << "Error: "s << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+    return 0;
+}
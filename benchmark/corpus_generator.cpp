@@ -0,0 +1,105 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent) {
+    if (size == 0) {
+        throw invalid_argument("Zipf distribution needs at least one rank"s);
+    }
+    cumulative_weights_.reserve(size);
+    double sum = 0.0;
+    for (size_t rank = 1; rank <= size; ++rank) {
+        sum += 1.0 / pow(static_cast<double>(rank), exponent);
+        cumulative_weights_.push_back(sum);
+    }
+}
+
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    uniform_real_distribution<double> uniform(0.0, cumulative_weights_.back());
+    const auto it = lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), uniform(generator));
+    return min(static_cast<size_t>(it - cumulative_weights_.begin()), cumulative_weights_.size() - 1);
+}
+
+vector<string> GenerateVocabulary(size_t size) {
+    vector<string> vocabulary;
+    vocabulary.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        // bijective base-26 keeps frequent words short, like in natural text
+        string word;
+        size_t value = i + 1;
+        while (value > 0) {
+            --value;
+            word += static_cast<char>('a' + value % 26);
+            value /= 26;
+        }
+        vocabulary.push_back(move(word));
+    }
+    return vocabulary;
+}
+
+namespace {
+
+string GenerateText(const vector<string>& vocabulary, const ZipfDistribution& zipf, size_t length, mt19937& generator) {
+    string text;
+    for (size_t i = 0; i < length; ++i) {
+        if (i > 0) {
+            text += ' ';
+        }
+        text += vocabulary[zipf(generator)];
+    }
+    return text;
+}
+
+} // namespace
+
+Corpus GenerateCorpus(const CorpusOptions& options) {
+    mt19937 generator(options.seed);
+    const vector<string> vocabulary = GenerateVocabulary(options.vocabulary_size);
+    const ZipfDistribution zipf(vocabulary.size(), options.zipf_exponent);
+
+    Corpus corpus;
+    const size_t stop_word_count = min(options.stop_word_count, vocabulary.size());
+    corpus.stop_words.assign(vocabulary.begin(), vocabulary.begin() + stop_word_count);
+
+    uniform_int_distribution<int> rating_distribution(-10, 10);
+    uniform_int_distribution<int> status_distribution(0, 9);
+    uniform_real_distribution<double> share(0.0, 1.0);
+
+    corpus.documents.reserve(options.document_count);
+    for (size_t i = 0; i < options.document_count; ++i) {
+        GeneratedDocument document;
+        document.id = static_cast<int>(i);
+        if (!corpus.documents.empty() && share(generator) < options.duplicate_ratio) {
+            uniform_int_distribution<size_t> source(0, corpus.documents.size() - 1);
+            document.text = corpus.documents[source(generator)].text;
+        } else {
+            document.text = GenerateText(vocabulary, zipf, options.document_length, generator);
+        }
+        // 90% of documents are ACTUAL, the rest is spread over other statuses
+        const int status = status_distribution(generator);
+        document.status = status < 9 ? DocumentStatus::ACTUAL : DocumentStatus::IRRELEVANT;
+        document.ratings = {rating_distribution(generator), rating_distribution(generator), rating_distribution(generator)};
+        corpus.documents.push_back(move(document));
+    }
+
+    corpus.queries.reserve(options.query_count);
+    for (size_t i = 0; i < options.query_count; ++i) {
+        string query;
+        for (size_t j = 0; j < options.query_length; ++j) {
+            if (j > 0) {
+                query += ' ';
+            }
+            if (share(generator) < options.minus_word_ratio) {
+                query += '-';
+            }
+            query += vocabulary[zipf(generator)];
+        }
+        corpus.queries.push_back(move(query));
+    }
+
+    return corpus;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "document.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+struct CorpusOptions {
+    size_t document_count = 10000;
+    size_t vocabulary_size = 20000;
+    size_t document_length = 50;
+    size_t query_count = 1000;
+    size_t query_length = 5;
+    size_t stop_word_count = 5;      // the most frequent words become stop words
+    double zipf_exponent = 1.0;
+    double minus_word_ratio = 0.2;
+    double duplicate_ratio = 0.05;   // share of documents repeating an earlier one
+    uint32_t seed = 42;
+};
+
+struct GeneratedDocument {
+    int id = 0;
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+struct Corpus {
+    std::vector<std::string> stop_words;
+    std::vector<GeneratedDocument> documents;
+    std::vector<std::string> queries;
+};
+
+// Samples ranks in [0, size) with probability proportional to 1 / (rank + 1)^exponent.
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+std::vector<std::string> GenerateVocabulary(size_t size);
+
+// The same options always produce the same corpus.
+Corpus GenerateCorpus(const CorpusOptions& options);
@@ -0,0 +1,230 @@
+#include "corpus_generator.h"
+#include "ranked_documents.h"
+#include "search_server.h"
+#include "shared_index.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Several reader processes query a shared index while a new generation is
+// published, and check every answer against the in-process SearchServer
+// that was published under the generation they used.
+
+struct SharedBenchmarkOptions {
+    CorpusOptions corpus;
+    int readers = 4;
+    size_t queries_after_switch = 1000;
+    int publish_delay_ms = 100;
+    string name = "/search_server_shared_index_bench"s;
+};
+
+struct ReaderReport {
+    uint64_t old_generation_queries = 0;
+    uint64_t new_generation_queries = 0;
+    uint64_t mismatches = 0;
+    int64_t elapsed_ns = 0;
+};
+
+void PrintUsage(ostream& out) {
+    out << "Usage: search_server_shared_index_bench [options]\n"
+           "  --documents=N          documents per published generation (default 10000)\n"
+           "  --readers=N            reader processes (default 4)\n"
+           "  --queries=N            distinct queries (default 1000)\n"
+           "  --queries-after-switch=N  queries every reader runs on the new generation (default 1000)\n"
+           "  --publish-delay-ms=N   time before the second generation is published (default 100)\n"
+           "  --seed=N               random seed (default 42)\n"
+           "  --name=/NAME           shared memory name\n";
+}
+
+SharedBenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    SharedBenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const string key = arg.substr(0, eq);
+        const string value = eq == string::npos ? ""s : arg.substr(eq + 1);
+        if (key == "--help"s) {
+            PrintUsage(cout);
+            exit(0);
+        } else if (key == "--documents"s) {
+            options.corpus.document_count = stoul(value);
+        } else if (key == "--readers"s) {
+            options.readers = max(1, stoi(value));
+        } else if (key == "--queries"s) {
+            options.corpus.query_count = max<size_t>(1, stoul(value));
+        } else if (key == "--queries-after-switch"s) {
+            options.queries_after_switch = stoul(value);
+        } else if (key == "--publish-delay-ms"s) {
+            options.publish_delay_ms = max(0, stoi(value));
+        } else if (key == "--seed"s) {
+            options.corpus.seed = static_cast<uint32_t>(stoul(value));
+        } else if (key == "--name"s) {
+            options.name = value;
+        } else {
+            throw invalid_argument("Unknown option "s + arg);
+        }
+    }
+    return options;
+}
+
+SearchServer BuildServer(const Corpus& corpus) {
+    SearchServer server(corpus.stop_words);
+    for (const GeneratedDocument& document : corpus.documents) {
+        server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    return server;
+}
+
+vector<vector<Document>> FindAll(const SearchServer& server, const vector<string>& queries) {
+    vector<vector<Document>> results;
+    results.reserve(queries.size());
+    for (const string& query : queries) {
+        results.push_back(server.FindTopDocuments(query));
+    }
+    return results;
+}
+
+bool AreEqual(const vector<Document>& lhs, const vector<Document>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].id != rhs[i].id || lhs[i].rating != rhs[i].rating
+            || abs(lhs[i].relevance - rhs[i].relevance) >= EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ReaderReport RunReader(const SharedBenchmarkOptions& options, const vector<string>& queries,
+                       uint64_t old_generation, const vector<vector<Document>>& old_expected,
+                       uint64_t new_generation, const vector<vector<Document>>& new_expected) {
+    ReaderReport report;
+    SharedIndexReader reader(options.name);
+    const auto start = chrono::steady_clock::now();
+    for (size_t i = 0; report.new_generation_queries < options.queries_after_switch; i = (i + 1) % queries.size()) {
+        const auto snapshot = reader.GetSnapshot();
+        const vector<Document> result = snapshot->FindTopDocuments(queries[i]);
+        if (snapshot->GetGeneration() == old_generation) {
+            ++report.old_generation_queries;
+            report.mismatches += AreEqual(result, old_expected[i]) ? 0 : 1;
+        } else if (snapshot->GetGeneration() == new_generation) {
+            ++report.new_generation_queries;
+            report.mismatches += AreEqual(result, new_expected[i]) ? 0 : 1;
+        } else {
+            throw runtime_error("Unexpected generation "s + to_string(snapshot->GetGeneration()));
+        }
+    }
+    report.elapsed_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const SharedBenchmarkOptions options = ParseOptions(argc, argv);
+
+        const Corpus old_corpus = GenerateCorpus(options.corpus);
+        CorpusOptions new_corpus_options = options.corpus;
+        ++new_corpus_options.seed;
+        const Corpus new_corpus = GenerateCorpus(new_corpus_options);
+        const SearchServer old_server = BuildServer(old_corpus);
+        const SearchServer new_server = BuildServer(new_corpus);
+        const vector<string>& queries = old_corpus.queries;
+        const vector<vector<Document>> old_expected = FindAll(old_server, queries);
+        const vector<vector<Document>> new_expected = FindAll(new_server, queries);
+
+        SharedIndexPublisher publisher(options.name);
+        const uint64_t old_generation = publisher.Publish(old_server);
+        const uint64_t new_generation = old_generation + 1;
+
+        int report_pipe[2];
+        if (pipe(report_pipe) != 0) {
+            throw runtime_error("Cannot create a pipe"s);
+        }
+        vector<pid_t> readers;
+        for (int i = 0; i < options.readers; ++i) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                throw runtime_error("Cannot start a reader process"s);
+            }
+            if (pid == 0) {
+                close(report_pipe[0]);
+                int exit_code = 0;
+                ReaderReport report;
+                try {
+                    report = RunReader(options, queries, old_generation, old_expected, new_generation, new_expected);
+                } catch (const exception& e) {
+                    cerr << "Reader error: "s << e.what() << endl;
+                    exit_code = 1;
+                }
+                if (write(report_pipe[1], &report, sizeof(report)) != static_cast<ssize_t>(sizeof(report))) {
+                    exit_code = 1;
+                }
+                _exit(exit_code);
+            }
+            readers.push_back(pid);
+        }
+        close(report_pipe[1]);
+
+        this_thread::sleep_for(chrono::milliseconds(options.publish_delay_ms));
+        const auto publish_start = chrono::steady_clock::now();
+        if (publisher.Publish(new_server) != new_generation) {
+            throw runtime_error("Unexpected generation number"s);
+        }
+        const auto publish_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - publish_start).count();
+
+        ReaderReport total;
+        int failed_readers = 0;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            ReaderReport report;
+            if (read(report_pipe[0], &report, sizeof(report)) == static_cast<ssize_t>(sizeof(report))) {
+                total.old_generation_queries += report.old_generation_queries;
+                total.new_generation_queries += report.new_generation_queries;
+                total.mismatches += report.mismatches;
+                total.elapsed_ns = max(total.elapsed_ns, report.elapsed_ns);
+            }
+        }
+        close(report_pipe[0]);
+        for (const pid_t pid : readers) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                ++failed_readers;
+            }
+        }
+        publisher.Unlink();
+
+        const uint64_t query_count = total.old_generation_queries + total.new_generation_queries;
+        cout << "{\"documents\": "s << options.corpus.document_count
+             << ", \"readers\": "s << options.readers
+             << ", \"generations\": ["s << old_generation << ", "s << new_generation << ']'
+             << ", \"publish_ns\": "s << publish_ns
+             << ", \"queries\": {\"old_generation\": "s << total.old_generation_queries
+             << ", \"new_generation\": "s << total.new_generation_queries << '}'
+             << ", \"queries_per_second\": "s
+             << (total.elapsed_ns > 0 ? static_cast<double>(query_count) * 1e9 / static_cast<double>(total.elapsed_ns) : 0.0)
+             << ", \"mismatches\": "s << total.mismatches
+             << ", \"failed_readers\": "s << failed_readers << '}' << endl;
+        return total.mismatches == 0 && failed_readers == 0 ? 0 : 1;
+    } catch (const exception& e) {
+        cerr << "Error: "s << e.what() << endl;
+        PrintUsage(cerr);
+        return 1;
+    }
+}
@@ -0,0 +1,556 @@
+#include "bulk_loader.h"
+
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+class MappedFile {
+public:
+    explicit MappedFile(const string& path) {
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw runtime_error("Cannot open "s + path + ": "s + strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(fd_, &file_stat) != 0) {
+            close(fd_);
+            throw runtime_error("Cannot stat "s + path + ": "s + strerror(errno));
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ == 0) {
+            return;
+        }
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (data == MAP_FAILED) {
+            close(fd_);
+            throw runtime_error("Cannot map "s + path + ": "s + strerror(errno));
+        }
+        data_ = static_cast<const char*>(data);
+        madvise(data, size_, MADV_SEQUENTIAL);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        close(fd_);
+    }
+
+    string_view GetData() const {
+        return {data_, size_};
+    }
+
+    // Drops the pages of an already indexed range so resident memory does not grow with the file.
+    void Release(size_t offset, size_t length) const {
+        if (data_ == nullptr) {
+            return;
+        }
+        const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t begin = (offset + page_size - 1) / page_size * page_size;
+        const size_t end = (offset + length) / page_size * page_size;
+        if (begin < end) {
+            madvise(const_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+        }
+    }
+
+private:
+    int fd_ = -1;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct ParsedDocument {
+    int id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    vector<int> ratings;
+    vector<string_view> words;
+};
+
+struct ParsedChunk {
+    size_t offset = 0;
+    size_t length = 0;
+    // Unescaped JSON texts; deque keeps them in place while words view them.
+    deque<string> owned_texts;
+    vector<ParsedDocument> documents;
+    exception_ptr error;
+};
+
+[[noreturn]] void ThrowMalformed(size_t offset, const string& reason) {
+    throw invalid_argument("Malformed line at byte "s + to_string(offset) + ": "s + reason);
+}
+
+optional<DocumentStatus> FindDocumentStatus(string_view text) {
+    if (text == "ACTUAL"sv || text == "0"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv || text == "1"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv || text == "2"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv || text == "3"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    return nullopt;
+}
+
+// Same values as ParseDocumentStatus, but the error carries the line offset
+DocumentStatus ParseStatus(string_view text, size_t offset) {
+    const optional<DocumentStatus> status = FindDocumentStatus(text);
+    if (!status) {
+        ThrowMalformed(offset, "unknown status "s + string(text));
+    }
+    return *status;
+}
+
+int ParseInt(string_view text, size_t offset) {
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size()) {
+        ThrowMalformed(offset, "invalid number "s + string(text));
+    }
+    return value;
+}
+
+ParsedDocument ParseTsvLine(string_view line, size_t offset) {
+    string_view fields[3];
+    for (string_view& field : fields) {
+        const size_t tab = line.find('\t');
+        if (tab == string_view::npos) {
+            ThrowMalformed(offset, "expected id, status, ratings and text separated by tabs"s);
+        }
+        field = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+
+    ParsedDocument document;
+    document.id = ParseInt(fields[0], offset);
+    document.status = ParseStatus(fields[1], offset);
+    for (const string_view rating : SplitIntoWordViews(fields[2])) {
+        document.ratings.push_back(ParseInt(rating, offset));
+    }
+    document.words = SplitIntoWordViews(line);
+    return document;
+}
+
+// Parser for flat JSON objects with string, integer and integer array values.
+class JsonLineParser {
+public:
+    JsonLineParser(string_view line, size_t offset, deque<string>& storage)
+        : line_(line), offset_(offset), storage_(storage)
+    {
+    }
+
+    ParsedDocument Parse() {
+        ParsedDocument document;
+        bool has_id = false;
+        bool has_text = false;
+        Expect('{');
+        if (!TryConsume('}')) {
+            do {
+                const string_view key = ParseString();
+                Expect(':');
+                if (key == "id"sv) {
+                    document.id = ParseInteger();
+                    has_id = true;
+                } else if (key == "status"sv) {
+                    SkipSpaces();
+                    // numbers go through the same check as TSV, so 9 is rejected rather than cast
+                    document.status = ParseStatus(
+                        pos_ < line_.size() && line_[pos_] == '"' ? ParseString() : ParseNumber(), offset_);
+                } else if (key == "ratings"sv) {
+                    document.ratings = ParseIntegerArray();
+                } else if (key == "text"sv) {
+                    document.words = SplitIntoWordViews(ParseString());
+                    has_text = true;
+                } else {
+                    ThrowMalformed(offset_, "unknown key "s + string(key));
+                }
+            } while (TryConsume(','));
+            Expect('}');
+        }
+        SkipSpaces();
+        if (pos_ != line_.size()) {
+            ThrowMalformed(offset_, "trailing characters after object"s);
+        }
+        if (!has_id || !has_text) {
+            ThrowMalformed(offset_, "\"id\" and \"text\" are required"s);
+        }
+        return document;
+    }
+
+private:
+    string_view line_;
+    size_t pos_ = 0;
+    size_t offset_;
+    deque<string>& storage_;
+
+    void SkipSpaces() {
+        while (pos_ < line_.size() && (line_[pos_] == ' ' || line_[pos_] == '\t')) {
+            ++pos_;
+        }
+    }
+
+    bool TryConsume(char c) {
+        SkipSpaces();
+        if (pos_ < line_.size() && line_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(char c) {
+        if (!TryConsume(c)) {
+            ThrowMalformed(offset_, "expected '"s + c + "'"s);
+        }
+    }
+
+    // Text of an optionally negative integer
+    string_view ParseNumber() {
+        SkipSpaces();
+        const size_t begin = pos_;
+        if (pos_ < line_.size() && line_[pos_] == '-') {
+            ++pos_;
+        }
+        while (pos_ < line_.size() && line_[pos_] >= '0' && line_[pos_] <= '9') {
+            ++pos_;
+        }
+        return line_.substr(begin, pos_ - begin);
+    }
+
+    int ParseInteger() {
+        return ParseInt(ParseNumber(), offset_);
+    }
+
+    vector<int> ParseIntegerArray() {
+        vector<int> values;
+        Expect('[');
+        if (TryConsume(']')) {
+            return values;
+        }
+        do {
+            values.push_back(ParseInteger());
+        } while (TryConsume(','));
+        Expect(']');
+        return values;
+    }
+
+    // Strings without escapes are returned as views of the input line.
+    string_view ParseString() {
+        Expect('"');
+        const size_t begin = pos_;
+        while (pos_ < line_.size() && line_[pos_] != '"' && line_[pos_] != '\\') {
+            ++pos_;
+        }
+        if (pos_ < line_.size() && line_[pos_] == '"') {
+            return line_.substr(begin, pos_++ - begin);
+        }
+
+        string& text = storage_.emplace_back(line_.substr(begin, pos_ - begin));
+        while (pos_ < line_.size() && line_[pos_] != '"') {
+            const char c = line_[pos_++];
+            if (c != '\\') {
+                text += c;
+                continue;
+            }
+            if (pos_ == line_.size()) {
+                break;
+            }
+            const char escaped = line_[pos_++];
+            switch (escaped) {
+                case 'n':
+                case 't':
+                case 'r':
+                case 'b':
+                case 'f':
+                    // control characters separate words in the text
+                    text += ' ';
+                    break;
+                case 'u':
+                    AppendCodePoint(text);
+                    break;
+                default:
+                    text += escaped;
+            }
+        }
+        Expect('"');
+        return text;
+    }
+
+    unsigned ParseHexQuad() {
+        if (pos_ + 4 > line_.size()) {
+            ThrowMalformed(offset_, "truncated \\u escape"s);
+        }
+        unsigned code_unit = 0;
+        const auto [end, error] = from_chars(line_.data() + pos_, line_.data() + pos_ + 4, code_unit, 16);
+        if (error != errc() || end != line_.data() + pos_ + 4) {
+            ThrowMalformed(offset_, "invalid \\u escape"s);
+        }
+        pos_ += 4;
+        return code_unit;
+    }
+
+    // Characters outside the BMP come as a UTF-16 surrogate pair: \uD83D\uDE00
+    void AppendCodePoint(string& text) {
+        unsigned code_point = ParseHexQuad();
+        if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+            ThrowMalformed(offset_, "unpaired low surrogate in \\u escape"s);
+        }
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+            if (line_.substr(pos_, 2) != "\\u"sv) {
+                ThrowMalformed(offset_, "unpaired high surrogate in \\u escape"s);
+            }
+            pos_ += 2;
+            const unsigned low = ParseHexQuad();
+            if (low < 0xDC00 || low > 0xDFFF) {
+                ThrowMalformed(offset_, "unpaired high surrogate in \\u escape"s);
+            }
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        if (code_point < 0x20) {
+            text += ' ';
+        } else if (code_point < 0x80) {
+            text += static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            text += static_cast<char>(0xC0 | (code_point >> 6));
+            text += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            text += static_cast<char>(0xE0 | (code_point >> 12));
+            text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+            text += static_cast<char>(0xF0 | (code_point >> 18));
+            text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+};
+
+ParsedChunk ParseChunk(string_view data, size_t offset, size_t length, InputFormat format) {
+    ParsedChunk chunk;
+    chunk.offset = offset;
+    chunk.length = length;
+    const string_view text = data.substr(offset, length);
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == string_view::npos) {
+            end = text.size();
+        }
+        string_view line = text.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            if (format == InputFormat::TSV) {
+                chunk.documents.push_back(ParseTsvLine(line, offset + pos));
+            } else {
+                chunk.documents.push_back(JsonLineParser(line, offset + pos, chunk.owned_texts).Parse());
+            }
+        }
+        pos = end + 1;
+    }
+    return chunk;
+}
+
+// Producer thread cuts the file into chunks, worker threads parse them and the
+// consumer takes parsed chunks back in file order. A chunk holds one of the
+// max_chunks_in_flight slots from being cut until the consumer finishes it.
+class LoadPipeline {
+public:
+    LoadPipeline(const MappedFile& file, const BulkLoadOptions& options)
+        : file_(file)
+        , format_(options.format)
+        , chunk_size_(max<size_t>(options.chunk_size, 1))
+        , max_in_flight_(options.max_chunks_in_flight > 0 ? options.max_chunks_in_flight
+                                                          : 2 * max<size_t>(options.worker_count, 1))
+    {
+        threads_.emplace_back([this] { Produce(); });
+        for (size_t i = 0; i < max<size_t>(options.worker_count, 1); ++i) {
+            threads_.emplace_back([this] { Work(); });
+        }
+    }
+
+    LoadPipeline(const LoadPipeline&) = delete;
+    LoadPipeline& operator=(const LoadPipeline&) = delete;
+
+    ~LoadPipeline() {
+        {
+            lock_guard guard(mutex_);
+            cancelled_ = true;
+        }
+        slots_cv_.notify_all();
+        work_cv_.notify_all();
+        for (thread& t : threads_) {
+            t.join();
+        }
+    }
+
+    // Returns false when the whole file has been handed out.
+    bool PopNextChunk(ParsedChunk& chunk) {
+        unique_lock lock(mutex_);
+        done_cv_.wait(lock, [this] {
+            return parsed_.count(next_chunk_) > 0 || (producer_done_ && next_chunk_ == chunk_count_);
+        });
+        auto it = parsed_.find(next_chunk_);
+        if (it == parsed_.end()) {
+            return false;
+        }
+        chunk = move(it->second);
+        parsed_.erase(it);
+        ++next_chunk_;
+        return true;
+    }
+
+    void FinishChunk(const ParsedChunk& chunk) {
+        file_.Release(chunk.offset, chunk.length);
+        {
+            lock_guard guard(mutex_);
+            --in_flight_;
+        }
+        slots_cv_.notify_one();
+    }
+
+private:
+    struct ChunkBounds {
+        size_t index;
+        size_t offset;
+        size_t length;
+    };
+
+    const MappedFile& file_;
+    const InputFormat format_;
+    const size_t chunk_size_;
+    const size_t max_in_flight_;
+
+    mutex mutex_;
+    condition_variable slots_cv_;
+    condition_variable work_cv_;
+    condition_variable done_cv_;
+    deque<ChunkBounds> pending_;
+    map<size_t, ParsedChunk> parsed_;
+    size_t in_flight_ = 0;
+    size_t chunk_count_ = 0;
+    size_t next_chunk_ = 0;
+    bool producer_done_ = false;
+    bool cancelled_ = false;
+    vector<thread> threads_;
+
+    void Produce() {
+        const string_view data = file_.GetData();
+        size_t offset = 0;
+        size_t index = 0;
+        while (offset < data.size()) {
+            size_t end = min(offset + chunk_size_, data.size());
+            if (end < data.size()) {
+                const size_t line_end = data.find('\n', end);
+                end = line_end == string_view::npos ? data.size() : line_end + 1;
+            }
+            {
+                unique_lock lock(mutex_);
+                slots_cv_.wait(lock, [this] { return in_flight_ < max_in_flight_ || cancelled_; });
+                if (cancelled_) {
+                    return;
+                }
+                ++in_flight_;
+                pending_.push_back({index++, offset, end - offset});
+            }
+            work_cv_.notify_one();
+            offset = end;
+        }
+        {
+            lock_guard guard(mutex_);
+            chunk_count_ = index;
+            producer_done_ = true;
+        }
+        work_cv_.notify_all();
+        done_cv_.notify_all();
+    }
+
+    void Work() {
+        while (true) {
+            ChunkBounds bounds;
+            {
+                unique_lock lock(mutex_);
+                work_cv_.wait(lock, [this] { return !pending_.empty() || producer_done_ || cancelled_; });
+                if (cancelled_ || pending_.empty()) {
+                    return;
+                }
+                bounds = pending_.front();
+                pending_.pop_front();
+            }
+
+            ParsedChunk chunk;
+            try {
+                chunk = ParseChunk(file_.GetData(), bounds.offset, bounds.length, format_);
+            } catch (...) {
+                chunk.offset = bounds.offset;
+                chunk.length = bounds.length;
+                chunk.error = current_exception();
+            }
+
+            {
+                lock_guard guard(mutex_);
+                parsed_.emplace(bounds.index, move(chunk));
+            }
+            done_cv_.notify_all();
+        }
+    }
+};
+
+} // namespace
+
+DocumentStatus ParseDocumentStatus(string_view text) {
+    const optional<DocumentStatus> status = FindDocumentStatus(text);
+    if (!status) {
+        throw invalid_argument("Unknown document status "s + string(text));
+    }
+    return *status;
+}
+
+BulkLoadResult LoadDocuments(SearchServer& search_server, const string& path, const BulkLoadOptions& options) {
+    const MappedFile file(path);
+    LoadPipeline pipeline(file, options);
+
+    BulkLoadResult result;
+    ParsedChunk chunk;
+    while (pipeline.PopNextChunk(chunk)) {
+        if (chunk.error) {
+            rethrow_exception(chunk.error);
+        }
+        for (const ParsedDocument& document : chunk.documents) {
+            try {
+                search_server.AddDocument(document.id, document.words, document.status, document.ratings);
+            } catch (const invalid_argument& e) {
+                throw invalid_argument("Document "s + to_string(document.id) + ": "s + e.what());
+            }
+            ++result.documents_added;
+        }
+        result.bytes_read += chunk.length;
+        pipeline.FinishChunk(chunk);
+    }
+    return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+enum class InputFormat {
+    TSV,    // id \t status \t space separated ratings \t text
+    JSONL,  // {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+};
+
+struct BulkLoadOptions {
+    InputFormat format = InputFormat::TSV;
+    // Chunks are cut at the first line break after chunk_size bytes.
+    size_t chunk_size = 4 << 20;
+    size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+    // Upper bound of chunks being parsed or waiting for indexing at once;
+    // together with chunk_size it bounds the loader's memory use.
+    size_t max_chunks_in_flight = 0;  // 0 means 2 * worker_count
+};
+
+struct BulkLoadResult {
+    size_t documents_added = 0;
+    size_t bytes_read = 0;
+};
+
+// Memory-maps the file and runs a parse -> tokenize -> index pipeline: worker
+// threads parse chunks of lines and split texts into words, the calling thread
+// adds the documents to the server in file order. Malformed input and
+// rejected documents are reported with std::invalid_argument; documents
+// indexed before the error stay in the server.
+BulkLoadResult LoadDocuments(SearchServer& search_server, const std::string& path, const BulkLoadOptions& options = {});
+
+// Status names match the enumerator names; numeric values are accepted as well.
+DocumentStatus ParseDocumentStatus(std::string_view text);
@@ -1,22 +1,36 @@
 #pragma once
 
+#include <cstddef>
 #include <map>
+#include <memory_resource>
 #include <mutex>
 #include <string>
 #include <vector>
 
 using namespace std::literals;
 
+// resource must be thread-safe: buckets take memory from it concurrently.
+// Each bucket carves its nodes out of its own arena under the bucket lock,
+// so the resource is only hit when an arena needs another chunk.
 template <typename Key, typename Value>
 class ConcurrentMap {
 private:
     struct Bucket {
-        std::map<Key, Value> map;
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit Bucket(const allocator_type& allocator)
+            : arena(allocator.resource())
+            , map(&arena)
+        {
+        }
+
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::map<Key, Value> map;
         std::mutex mutex;
     };
-    
-    std::vector<Bucket> buckets_;
-    
+
+    std::pmr::vector<Bucket> buckets_;
+
 public:
     struct Access {
         std::lock_guard<std::mutex> guard;
@@ -25,27 +39,28 @@ public:
         Value& operator +=(const Value& value) {
             return ref_to_value += value;
         }
-    };     
+    };
 
-    explicit ConcurrentMap(size_t bucket_count) : buckets_(bucket_count) {}
+    explicit ConcurrentMap(size_t bucket_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : buckets_(bucket_count, resource) {}
 
     Access operator[](const Key& key) {
         auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
         return {std::lock_guard(bucket.mutex), bucket.map[key]};
     }
 
-    std::map<Key, Value> BuildOrdinaryMap() {
-        std::map<Key, Value> result;
-        for (auto& [map, mutex] : buckets_) {
-            std::lock_guard guard(mutex);
-            result.insert(map.begin(), map.end());
+    std::pmr::map<Key, Value> BuildOrdinaryMap(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+        std::pmr::map<Key, Value> result(resource);
+        for (auto& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            result.insert(bucket.map.begin(), bucket.map.end());
         }
         return result;
     }
 
-    void erase(const Key& key){    
+    void erase(const Key& key){
         auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
         std::lock_guard guard(bucket.mutex);
         bucket.map.erase(key);
     }
-};
\ No newline at end of file
+};
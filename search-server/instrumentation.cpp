@@ -0,0 +1,193 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+
+using namespace std;
+
+const char* ToString(QueryStage stage) {
+    switch (stage) {
+        case QueryStage::PARSE:
+            return "parse";
+        case QueryStage::SCORE:
+            return "score";
+        case QueryStage::MERGE:
+            return "merge";
+        case QueryStage::SORT:
+            return "sort";
+        case QueryStage::TOTAL:
+            return "total";
+    }
+    return "unknown";
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) {
+    *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets_[i].store(other.buckets_[i].load(memory_order_relaxed), memory_order_relaxed);
+    }
+    count_.store(other.count_.load(memory_order_relaxed), memory_order_relaxed);
+    max_.store(other.max_.load(memory_order_relaxed), memory_order_relaxed);
+    return *this;
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63;
+    while ((value >> msb) == 0) {
+        --msb;
+    }
+    const int shift = msb - SUB_BUCKET_BITS;
+    const uint64_t sub_bucket = (value >> shift) - SUB_BUCKET_COUNT;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKET_COUNT;
+    return ((SUB_BUCKET_COUNT + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds duration) {
+    const uint64_t value = static_cast<uint64_t>(max<chrono::nanoseconds::rep>(duration.count(), 0));
+    buckets_[GetBucketIndex(value)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    uint64_t current_max = max_.load(memory_order_relaxed);
+    while (value > current_max && !max_.compare_exchange_weak(current_max, value, memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(memory_order_relaxed);
+}
+
+chrono::nanoseconds LatencyHistogram::GetMax() const {
+    return chrono::nanoseconds(max_.load(memory_order_relaxed));
+}
+
+chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const {
+    const uint64_t count = GetCount();
+    if (count == 0) {
+        return chrono::nanoseconds(0);
+    }
+    const double clamped = min(max(percentile, 0.0), 100.0);
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return chrono::nanoseconds(min(GetBucketUpperBound(i), max_.load(memory_order_relaxed)));
+        }
+    }
+    return GetMax();
+}
+
+LatencySummary Summarize(const LatencyHistogram& histogram) {
+    LatencySummary summary;
+    summary.count = histogram.GetCount();
+    summary.p50 = histogram.GetPercentile(50.0);
+    summary.p90 = histogram.GetPercentile(90.0);
+    summary.p99 = histogram.GetPercentile(99.0);
+    summary.max = histogram.GetMax();
+    return summary;
+}
+
+#ifdef SEARCH_SERVER_ENABLE_STATS
+
+QueryMetrics::QueryMetrics(const QueryMetrics& other) {
+    *this = other;
+}
+
+QueryMetrics& QueryMetrics::operator=(const QueryMetrics& other) {
+    stages_ = other.stages_;
+    postings_scanned_.store(other.GetPostingsScanned(), memory_order_relaxed);
+    documents_matched_.store(other.GetDocumentsMatched(), memory_order_relaxed);
+    return *this;
+}
+
+LatencySummary QueryMetrics::GetStageSummary(QueryStage stage) const {
+    return Summarize(stages_[static_cast<size_t>(stage)]);
+}
+
+uint64_t QueryMetrics::GetPostingsScanned() const {
+    return postings_scanned_.load(memory_order_relaxed);
+}
+
+uint64_t QueryMetrics::GetDocumentsMatched() const {
+    return documents_matched_.load(memory_order_relaxed);
+}
+
+#else
+
+QueryMetrics::QueryMetrics(const QueryMetrics&) = default;
+QueryMetrics& QueryMetrics::operator=(const QueryMetrics&) = default;
+
+LatencySummary QueryMetrics::GetStageSummary(QueryStage) const {
+    return {};
+}
+
+uint64_t QueryMetrics::GetPostingsScanned() const {
+    return 0;
+}
+
+uint64_t QueryMetrics::GetDocumentsMatched() const {
+    return 0;
+}
+
+#endif
+
+void PrintStatsAsText(ostream& out, const SearchServerStats& stats) {
+    const IndexStats& index = stats.index;
+    out << "documents: "s << index.document_count << '\n'
+        << "vocabulary: "s << index.vocabulary_size << '\n'
+        << "postings: "s << index.posting_count << '\n'
+        << "word_to_document_freqs bytes: "s << index.word_to_document_freqs_bytes << '\n'
+        << "id_to_word_freqs bytes: "s << index.id_to_word_freqs_bytes << '\n'
+        << "positions bytes: "s << index.positions_bytes << '\n'
+        << "term dictionary bytes: "s << index.term_dictionary_bytes << '\n'
+        << "documents bytes: "s << index.documents_bytes << '\n'
+        << "document_ids bytes: "s << index.document_ids_bytes << '\n'
+        << "postings scanned: "s << stats.postings_scanned << '\n'
+        << "documents matched: "s << stats.documents_matched << '\n';
+    for (size_t i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        const LatencySummary& summary = stats.stages[i];
+        out << ToString(static_cast<QueryStage>(i)) << ": count = "s << summary.count
+            << ", p50 = "s << summary.p50.count() << "ns, p90 = "s << summary.p90.count()
+            << "ns, p99 = "s << summary.p99.count() << "ns, max = "s << summary.max.count() << "ns\n"s;
+    }
+}
+
+void PrintStatsAsJson(ostream& out, const SearchServerStats& stats) {
+    const IndexStats& index = stats.index;
+    out << "{\"index\": {"s
+        << "\"documents\": "s << index.document_count
+        << ", \"vocabulary\": "s << index.vocabulary_size
+        << ", \"postings\": "s << index.posting_count
+        << ", \"bytes\": {"s
+        << "\"word_to_document_freqs\": "s << index.word_to_document_freqs_bytes
+        << ", \"id_to_word_freqs\": "s << index.id_to_word_freqs_bytes
+        << ", \"positions\": "s << index.positions_bytes
+        << ", \"term_dictionary\": "s << index.term_dictionary_bytes
+        << ", \"documents\": "s << index.documents_bytes
+        << ", \"document_ids\": "s << index.document_ids_bytes
+        << "}}, \"postings_scanned\": "s << stats.postings_scanned
+        << ", \"documents_matched\": "s << stats.documents_matched
+        << ", \"latency_ns\": {"s;
+    for (size_t i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        const LatencySummary& summary = stats.stages[i];
+        out << (i == 0 ? ""s : ", "s) << '"' << ToString(static_cast<QueryStage>(i)) << "\": {"s
+            << "\"count\": "s << summary.count
+            << ", \"p50\": "s << summary.p50.count()
+            << ", \"p90\": "s << summary.p90.count()
+            << ", \"p99\": "s << summary.p99.count()
+            << ", \"max\": "s << summary.max.count() << '}';
+    }
+    out << "}}"s;
+}
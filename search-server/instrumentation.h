@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// Instrumentation is enabled by defining SEARCH_SERVER_ENABLE_STATS (see CMakeLists.txt).
+// Without it timers and counters compile to empty inline functions.
+
+enum class QueryStage {
+    PARSE,
+    SCORE,
+    MERGE,
+    SORT,
+    TOTAL,
+};
+
+const size_t QUERY_STAGE_COUNT = 5;
+
+const char* ToString(QueryStage stage);
+
+// Log-linear (HDR-style) histogram: every power of two is split into 16 linear
+// sub-buckets, so any recorded value is reported with at most ~6% error.
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    void Record(std::chrono::nanoseconds duration);
+
+    uint64_t GetCount() const;
+    std::chrono::nanoseconds GetMax() const;
+    // percentile is in [0, 100]
+    std::chrono::nanoseconds GetPercentile(double percentile) const;
+
+private:
+    static const int SUB_BUCKET_BITS = 4;
+    static const uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const size_t BUCKET_COUNT = 64 * SUB_BUCKET_COUNT;
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t index);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct LatencySummary {
+    uint64_t count = 0;
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds max{0};
+};
+
+LatencySummary Summarize(const LatencyHistogram& histogram);
+
+class QueryMetrics {
+public:
+    QueryMetrics() = default;
+    QueryMetrics(const QueryMetrics& other);
+    QueryMetrics& operator=(const QueryMetrics& other);
+
+    void RecordStage(QueryStage stage, std::chrono::nanoseconds duration);
+    void AddPostingsScanned(uint64_t count);
+    void AddDocumentsMatched(uint64_t count);
+
+    LatencySummary GetStageSummary(QueryStage stage) const;
+    uint64_t GetPostingsScanned() const;
+    uint64_t GetDocumentsMatched() const;
+
+private:
+#ifdef SEARCH_SERVER_ENABLE_STATS
+    std::array<LatencyHistogram, QUERY_STAGE_COUNT> stages_;
+    std::atomic<uint64_t> postings_scanned_{0};
+    std::atomic<uint64_t> documents_matched_{0};
+#endif
+};
+
+// Records the time from construction until Stop() (or destruction) into the given stage.
+class StageTimer {
+public:
+    StageTimer(QueryMetrics& metrics, QueryStage stage);
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+    ~StageTimer();
+
+    void Stop();
+
+private:
+#ifdef SEARCH_SERVER_ENABLE_STATS
+    QueryMetrics* metrics_;
+    QueryStage stage_;
+    std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+// Approximate heap footprint of a std::map: every element lives in its own
+// red-black tree node (three pointers and a color word in libstdc++).
+const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+
+template <typename Map>
+size_t ApproximateMapBytes(const Map& map) {
+    return map.size() * (MAP_NODE_OVERHEAD + sizeof(typename Map::value_type));
+}
+
+struct IndexStats {
+    size_t document_count = 0;
+    size_t vocabulary_size = 0;
+    size_t posting_count = 0;
+    size_t word_to_document_freqs_bytes = 0;
+    size_t id_to_word_freqs_bytes = 0;
+    size_t positions_bytes = 0;
+    size_t term_dictionary_bytes = 0;
+    size_t documents_bytes = 0;
+    size_t document_ids_bytes = 0;
+};
+
+struct SearchServerStats {
+    IndexStats index;
+    std::array<LatencySummary, QUERY_STAGE_COUNT> stages;
+    uint64_t postings_scanned = 0;
+    uint64_t documents_matched = 0;
+};
+
+void PrintStatsAsText(std::ostream& out, const SearchServerStats& stats);
+void PrintStatsAsJson(std::ostream& out, const SearchServerStats& stats);
+
+#ifdef SEARCH_SERVER_ENABLE_STATS
+
+inline void QueryMetrics::RecordStage(QueryStage stage, std::chrono::nanoseconds duration) {
+    stages_[static_cast<size_t>(stage)].Record(duration);
+}
+
+inline void QueryMetrics::AddPostingsScanned(uint64_t count) {
+    postings_scanned_.fetch_add(count, std::memory_order_relaxed);
+}
+
+inline void QueryMetrics::AddDocumentsMatched(uint64_t count) {
+    documents_matched_.fetch_add(count, std::memory_order_relaxed);
+}
+
+inline StageTimer::StageTimer(QueryMetrics& metrics, QueryStage stage)
+    : metrics_(&metrics), stage_(stage), start_(std::chrono::steady_clock::now())
+{
+}
+
+inline StageTimer::~StageTimer() {
+    Stop();
+}
+
+inline void StageTimer::Stop() {
+    if (metrics_ != nullptr) {
+        metrics_->RecordStage(stage_, std::chrono::steady_clock::now() - start_);
+        metrics_ = nullptr;
+    }
+}
+
+#else
+
+inline void QueryMetrics::RecordStage(QueryStage, std::chrono::nanoseconds) {}
+inline void QueryMetrics::AddPostingsScanned(uint64_t) {}
+inline void QueryMetrics::AddDocumentsMatched(uint64_t) {}
+
+inline StageTimer::StageTimer(QueryMetrics&, QueryStage) {}
+inline StageTimer::~StageTimer() {}
+inline void StageTimer::Stop() {}
+
+#endif
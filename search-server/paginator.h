@@ -1,82 +1,253 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 template <typename It>
 class IteratorRange {
     public:
-        IteratorRange(It begin, It end, int size)
+        IteratorRange(It begin, It end, size_t size)
         : begin_(begin), end_(end), size_(size)
         {
         }
 
-        auto begin() { 
+        It begin() const {
             return begin_;
         }
-        auto end() {
+        It end() const {
             return end_;
         }
 
-        auto size() {
+        size_t size() const {
             return size_;
-        } 
+        }
 
     private:
         It begin_;
         It end_;
-        int size_;
+        size_t size_;
 };
 
 template <typename Iterator>
 std::ostream& operator << (std::ostream& out, IteratorRange<Iterator> iterator) {
-    for (auto it = iterator.begin(); it < iterator.end(); ++it) {
+    for (auto it = iterator.begin(); it != iterator.end(); ++it) {
         out << *it;
     }
 
     return out;
 }
 
-int DivUp(int x, int y)
+inline size_t DivUp(size_t x, size_t y)
 {
     return x / y + (x % y != 0 ? 1 : 0);
 }
 
+// Advances it by at most count steps without passing end; returns the number of steps taken.
 template <typename Iterator>
+size_t AdvanceBounded(Iterator& it, Iterator end, size_t count) {
+    using Category = typename std::iterator_traits<Iterator>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, Category>) {
+        const size_t steps = std::min(count, static_cast<size_t>(end - it));
+        it += steps;
+        return steps;
+    } else {
+        size_t steps = 0;
+        for (; steps < count && it != end; ++steps) {
+            ++it;
+        }
+        return steps;
+    }
+}
+
+// Pages are computed on demand while iterating, nothing is stored up front.
+// Forward iterators are enough; random access ones make size() and GetPage() O(1).
+template <typename Iterator, typename Category = typename std::iterator_traits<Iterator>::iterator_category>
 class Paginator {
     public:
-        Paginator() = default;
+        using Page = IteratorRange<Iterator>;
+
+        class PageIterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = Page;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const Page*;
+                using reference = const Page&;
+
+                PageIterator(Iterator begin, Iterator end, size_t page_size)
+                : page_(MakePage(begin, end, page_size)), end_(end), page_size_(page_size)
+                {
+                }
+
+                reference operator*() const {
+                    return page_;
+                }
+                pointer operator->() const {
+                    return &page_;
+                }
+
+                PageIterator& operator++() {
+                    page_ = MakePage(page_.end(), end_, page_size_);
+                    return *this;
+                }
+                PageIterator operator++(int) {
+                    PageIterator result = *this;
+                    ++*this;
+                    return result;
+                }
+
+                bool operator==(const PageIterator& other) const {
+                    return page_.begin() == other.page_.begin();
+                }
+                bool operator!=(const PageIterator& other) const {
+                    return !(*this == other);
+                }
+
+            private:
+                Page page_;
+                Iterator end_;
+                size_t page_size_;
+        };
 
-        Paginator(Iterator begin, Iterator end, int page_size)
+        Paginator(Iterator begin, Iterator end, size_t page_size)
+        : begin_(begin), end_(end), page_size_(page_size)
         {
-            number_of_page_ = DivUp(end - begin, page_size);
-            for (int i = 0; i < number_of_page_; ++i) {
-                auto end_range = begin + page_size;
-                if ( i != number_of_page_ - 1) {
-                    IteratorRange <Iterator> iterator_range(begin, end_range, page_size);
-                    pages_.push_back(iterator_range);
-                    begin += page_size;
-                } else {
-                    IteratorRange <Iterator> iterator_range(begin, end, end - begin);
-                    pages_.push_back(iterator_range);
-                    begin += page_size;
+            if (page_size_ == 0) {
+                throw std::invalid_argument("Page size must be positive");
+            }
+        }
+
+        PageIterator begin() const {
+            return PageIterator(begin_, end_, page_size_);
+        }
+
+        PageIterator end() const {
+            return PageIterator(end_, end_, page_size_);
+        }
+
+        size_t size() const {
+            return DivUp(static_cast<size_t>(std::distance(begin_, end_)), page_size_);
+        }
+
+        // Returns an empty page past the last one.
+        Page GetPage(size_t index) const {
+            Iterator page_begin = begin_;
+            if (index > 0 && AdvanceBounded(page_begin, end_, index * page_size_) < index * page_size_) {
+                return Page(end_, end_, 0);
+            }
+            return MakePage(page_begin, end_, page_size_);
+        }
+
+    private:
+        Iterator begin_;
+        Iterator end_;
+        size_t page_size_;
+
+        static Page MakePage(Iterator begin, Iterator end, size_t page_size) {
+            Iterator page_end = begin;
+            const size_t size = AdvanceBounded(page_end, end, page_size);
+            return Page(begin, page_end, size);
+        }
+};
+
+// Single-pass input ranges (e.g. RankedDocuments): each page is read into a
+// buffer when the page iterator reaches it, so the pages can be walked only once.
+template <typename Iterator>
+class Paginator<Iterator, std::input_iterator_tag> {
+    public:
+        using Page = std::vector<typename std::iterator_traits<Iterator>::value_type>;
+
+        class PageIterator {
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using value_type = Page;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const Page*;
+                using reference = const Page&;
+
+                explicit PageIterator(Paginator* owner)
+                : owner_(owner)
+                {
+                }
+
+                reference operator*() const {
+                    return owner_->page_;
+                }
+                pointer operator->() const {
+                    return &owner_->page_;
+                }
+
+                PageIterator& operator++() {
+                    owner_->LoadNextPage();
+                    return *this;
+                }
+                void operator++(int) {
+                    ++*this;
+                }
+
+                bool operator==(const PageIterator& other) const {
+                    return IsEnd() == other.IsEnd();
+                }
+                bool operator!=(const PageIterator& other) const {
+                    return !(*this == other);
                 }
+
+            private:
+                Paginator* owner_;
+
+                bool IsEnd() const {
+                    return owner_ == nullptr || owner_->page_.empty();
+                }
+        };
+
+        Paginator(Iterator begin, Iterator end, size_t page_size)
+        : current_(begin), end_(end), page_size_(page_size)
+        {
+            if (page_size_ == 0) {
+                throw std::invalid_argument("Page size must be positive");
             }
         }
-    
-        auto begin() const {
-            return pages_.begin();
+
+        Paginator(const Paginator&) = delete;
+        Paginator& operator=(const Paginator&) = delete;
+
+        PageIterator begin() {
+            if (!started_) {
+                started_ = true;
+                LoadNextPage();
+            }
+            return PageIterator(this);
         }
 
-        auto end() const {
-            return pages_.end();
+        PageIterator end() {
+            return PageIterator(nullptr);
         }
-    
+
     private:
-        std::vector<IteratorRange<Iterator>> pages_;
-        int number_of_page_;
+        Iterator current_;
+        Iterator end_;
+        size_t page_size_;
+        Page page_;
+        bool started_ = false;
+
+        void LoadNextPage() {
+            page_.clear();
+            for (; page_.size() < page_size_ && current_ != end_; ++current_) {
+                page_.push_back(*current_);
+            }
+        }
 };
 
+template <typename Container>
+auto Paginate(Container& c, size_t page_size) {
+    return Paginator<decltype(std::begin(c))>(std::begin(c), std::end(c), page_size);
+}
+
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
-    return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+    return Paginator<decltype(std::begin(c))>(std::begin(c), std::end(c), page_size);
+}
@@ -0,0 +1,100 @@
+#include "positional_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+void WordPositions::Add(int document_id, const vector<uint32_t>& positions) {
+    const auto it = lower_bound(entries_.begin(), entries_.end(), document_id, [](const Entry& entry, int id) {
+        return entry.document_id < id;
+    });
+    const size_t offset = bytes_.size();
+    uint32_t last_position = 0;
+    for (const uint32_t position : positions) {
+        uint32_t delta = position - last_position;
+        last_position = position;
+        while (delta >= 0x80) {
+            bytes_.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        bytes_.push_back(static_cast<uint8_t>(delta));
+    }
+    entries_.insert(it, {document_id, static_cast<uint32_t>(offset), static_cast<uint32_t>(bytes_.size() - offset)});
+}
+
+void WordPositions::Erase(int document_id) {
+    const auto it = lower_bound(entries_.begin(), entries_.end(), document_id, [](const Entry& entry, int id) {
+        return entry.document_id < id;
+    });
+    if (it == entries_.end() || it->document_id != document_id) {
+        return;
+    }
+    erased_byte_count_ += it->length;
+    entries_.erase(it);
+    if (erased_byte_count_ * 2 > bytes_.size()) {
+        Compact();
+    }
+}
+
+vector<uint32_t> WordPositions::Decode(int document_id) const {
+    vector<uint32_t> positions;
+    const auto it = lower_bound(entries_.begin(), entries_.end(), document_id, [](const Entry& entry, int id) {
+        return entry.document_id < id;
+    });
+    if (it == entries_.end() || it->document_id != document_id) {
+        return positions;
+    }
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (size_t i = it->offset; i < it->offset + it->length; ++i) {
+        const uint8_t byte = bytes_[i];
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
+
+size_t WordPositions::GetByteSize() const {
+    return entries_.capacity() * sizeof(Entry) + bytes_.capacity();
+}
+
+void WordPositions::Compact() {
+    vector<uint8_t> bytes;
+    bytes.reserve(bytes_.size() - erased_byte_count_);
+    for (Entry& entry : entries_) {
+        const auto begin = bytes_.begin() + entry.offset;
+        entry.offset = static_cast<uint32_t>(bytes.size());
+        bytes.insert(bytes.end(), begin, begin + entry.length);
+    }
+    bytes_ = move(bytes);
+    entries_.shrink_to_fit();
+    erased_byte_count_ = 0;
+}
+
+uint32_t ComputeMinimalWordDistance(const vector<vector<uint32_t>>& positions) {
+    vector<pair<uint32_t, size_t>> merged;
+    for (size_t word_index = 0; word_index < positions.size(); ++word_index) {
+        for (const uint32_t position : positions[word_index]) {
+            merged.push_back({position, word_index});
+        }
+    }
+    sort(merged.begin(), merged.end());
+
+    uint32_t distance = numeric_limits<uint32_t>::max();
+    for (size_t i = 1; i < merged.size(); ++i) {
+        if (merged[i].second != merged[i - 1].second) {
+            distance = min(distance, merged[i].first - merged[i - 1].first);
+        }
+    }
+    return distance == numeric_limits<uint32_t>::max() ? 0 : distance;
+}
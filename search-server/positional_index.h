@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Positions of one word in every document that contains it. Each document's
+// ascending positions are varint encoded deltas (most gaps fit into a single
+// byte), and the lists of all documents share one byte stream; a 12-byte entry
+// per document locates its list.
+class WordPositions {
+public:
+    // positions must be ascending; document_id must not be present yet
+    void Add(int document_id, const std::vector<uint32_t>& positions);
+    void Erase(int document_id);
+
+    // Empty if the document does not contain the word
+    std::vector<uint32_t> Decode(int document_id) const;
+
+    size_t GetByteSize() const;
+
+private:
+    struct Entry {
+        int document_id;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<Entry> entries_;  // by ascending document_id
+    std::vector<uint8_t> bytes_;
+    // bytes of erased documents still in bytes_, dropped once they are half of it
+    size_t erased_byte_count_ = 0;
+
+    void Compact();
+};
+
+// Smallest distance between positions of two different words; positions[i]
+// holds the ascending positions of word i. Returns 0 if fewer than two words occur.
+uint32_t ComputeMinimalWordDistance(const std::vector<std::vector<uint32_t>>& positions);
@@ -7,12 +7,7 @@
 using namespace std;
 
 vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
-    vector<vector<Document>> result(queries.size());
-    transform(execution::par, queries.begin(), queries.end(), result.begin(), [&] (const string& query) {
-        return search_server.FindTopDocuments(query);
-    });
-
-    return result;
+    return search_server.FindTopDocumentsBatch(queries);
 }
 
 vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
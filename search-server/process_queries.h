@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 
+// Evaluates the queries as one batch, see SearchServer::FindTopDocumentsBatch
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
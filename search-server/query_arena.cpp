@@ -0,0 +1,91 @@
+#include "query_arena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const size_t INITIAL_BUFFER_SIZE = 64 * 1024;
+// A larger query takes the excess from the heap every time instead of
+// pinning the memory to the thread
+const size_t MAX_BUFFER_SIZE = 16 * 1024 * 1024;
+
+struct ThreadBuffer {
+    vector<byte> bytes = vector<byte>(INITIAL_BUFFER_SIZE);
+    bool is_in_use = false;
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+vector<byte>* AcquireThreadBuffer() {
+    if (thread_buffer.is_in_use) {
+        return nullptr;
+    }
+    thread_buffer.is_in_use = true;
+    return &thread_buffer.bytes;
+}
+
+} // namespace
+
+QueryArena::QueryArena()
+    : buffer_(AcquireThreadBuffer())
+{
+    if (buffer_ != nullptr) {
+        resource_.emplace(buffer_->data(), buffer_->size(), &overflow_);
+    } else {
+        resource_.emplace(&overflow_);
+    }
+}
+
+QueryArena::~QueryArena() {
+    resource_.reset();
+    if (buffer_ == nullptr) {
+        return;
+    }
+    const size_t used_size = buffer_->size() + overflow_.GetAllocatedBytes();
+    if (used_size > buffer_->size() && buffer_->size() < MAX_BUFFER_SIZE) {
+        *buffer_ = vector<byte>(min(used_size * 2, MAX_BUFFER_SIZE));
+    }
+    thread_buffer.is_in_use = false;
+}
+
+pmr::memory_resource* QueryArena::GetResource() {
+    return &*resource_;
+}
+
+size_t QueryArena::OverflowResource::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    allocated_bytes_ += bytes;
+    return pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+SynchronizedResource::SynchronizedResource(pmr::memory_resource* upstream)
+    : upstream_(upstream)
+{
+}
+
+void* SynchronizedResource::do_allocate(size_t bytes, size_t alignment) {
+    lock_guard guard(mutex_);
+    return upstream_->allocate(bytes, alignment);
+}
+
+void SynchronizedResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    lock_guard guard(mutex_);
+    upstream_->deallocate(pointer, bytes, alignment);
+}
+
+bool SynchronizedResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
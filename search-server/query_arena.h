@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Scratch memory for the transient structures of one query: parsed words,
+// the plan, the relevance map and matched documents. Each thread keeps one
+// buffer that its queries reuse; when a query outgrows it, the buffer is
+// enlarged for the next query, so steady-state queries allocate nothing from
+// the global heap. Everything allocated from the arena is freed at once when
+// the arena is destroyed.
+class QueryArena {
+public:
+    QueryArena();
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+    ~QueryArena();
+
+    // Not thread-safe; wrap in SynchronizedResource to share between threads.
+    std::pmr::memory_resource* GetResource();
+
+private:
+    // Heap memory taken once the thread buffer is exhausted
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t GetAllocatedBytes() const;
+
+    private:
+        size_t allocated_bytes_ = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    OverflowResource overflow_;
+    // This thread's buffer; null for an arena created while another one is
+    // alive on the thread, e.g. by a predicate that runs a query itself.
+    std::vector<std::byte>* buffer_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+// Serializes allocations from an upstream resource, e.g. a QueryArena whose
+// memory is filled by the workers of a parallel query.
+class SynchronizedResource : public std::pmr::memory_resource {
+public:
+    explicit SynchronizedResource(std::pmr::memory_resource* upstream);
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::mutex mutex_;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
@@ -0,0 +1,60 @@
+#include "query_executor.h"
+
+using namespace std;
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < max<size_t>(thread_count, 1); ++i) {
+        threads_.emplace_back([this] { Run(); });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+    for (thread& t : threads_) {
+        t.join();
+    }
+}
+
+QueryExecutor& QueryExecutor::GetShared() {
+    static QueryExecutor executor;
+    return executor;
+}
+
+void QueryExecutor::Run() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            tasks_cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+CancellationToken::CancellationToken()
+    : is_cancelled_(make_shared<atomic<bool>>(false))
+{
+}
+
+void CancellationToken::Cancel() const {
+    is_cancelled_->store(true, memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const {
+    return is_cancelled_->load(memory_order_relaxed);
+}
+
+bool SearchControl::ShouldStop() const {
+    return cancellation.IsCancelled()
+        || (deadline != Deadline::max() && chrono::steady_clock::now() >= deadline);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size thread pool running queued tasks in FIFO order.
+class QueryExecutor {
+public:
+    explicit QueryExecutor(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+    // Finishes the queued tasks and joins the threads
+    ~QueryExecutor();
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task task);
+
+    // Process-wide executor with one thread per hardware thread
+    static QueryExecutor& GetShared();
+
+private:
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable tasks_cv_;
+    bool stopping_ = false;
+
+    void Run();
+};
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> QueryExecutor::Submit(Task task) {
+    // std::function needs a copyable callable, packaged_task is move-only
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::move(task));
+    auto future = packaged->get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.push_back([packaged] { (*packaged)(); });
+    }
+    tasks_cv_.notify_one();
+    return future;
+}
+
+// Shared flag to stop a running query; copies refer to the same flag.
+class CancellationToken {
+public:
+    CancellationToken();
+
+    void Cancel() const;
+    bool IsCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> is_cancelled_;
+};
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+struct SearchControl {
+    Deadline deadline = Deadline::max();
+    CancellationToken cancellation;
+
+    bool ShouldStop() const;
+};
@@ -0,0 +1,49 @@
+#include "query_plan.h"
+
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void PrintTerm(ostream& out, const string& action, const QueryPlanTerm& term) {
+    out << action << " \""s << term.word << "\": documents = "s << term.document_count;
+}
+
+} // namespace
+
+QueryPlan::QueryPlan(pmr::memory_resource* resource)
+    : minus_terms(resource)
+    , scored_terms(resource)
+    , dropped_terms(resource)
+{
+}
+
+size_t QueryPlan::GetPostingCount() const {
+    size_t count = 0;
+    for (const auto* terms : {&minus_terms, &scored_terms}) {
+        for (const QueryPlanTerm& term : *terms) {
+            count += term.document_count;
+        }
+    }
+    return count;
+}
+
+ostream& operator<<(ostream& out, const QueryPlan& plan) {
+    for (const QueryPlanTerm& term : plan.minus_terms) {
+        PrintTerm(out, "exclude"s, term);
+        out << '\n';
+    }
+    if (plan.matches_all_documents) {
+        out << "match all documents\n"s;
+    }
+    for (const QueryPlanTerm& term : plan.scored_terms) {
+        PrintTerm(out, "score"s, term);
+        out << ", idf = "s << term.inverse_document_freq << '\n';
+    }
+    for (const QueryPlanTerm& term : plan.dropped_terms) {
+        PrintTerm(out, "drop"s, term);
+        out << (term.document_count == 0 ? ", no postings\n"s : ", idf = 0\n"s);
+    }
+    return out << "postings: "s << plan.GetPostingCount() << '\n';
+}
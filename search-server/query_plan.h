@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+struct QueryPlanTerm {
+    std::string_view word;
+    size_t document_count = 0;
+    double inverse_document_freq = 0.0;
+};
+
+// How SearchServer evaluates a query: minus words are read first into a set of
+// excluded documents, then plus words are scored from the rarest one. Plus words
+// without postings or present in every document (IDF = 0) add nothing to any
+// relevance, so their postings are never read.
+struct QueryPlan {
+    explicit QueryPlan(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    std::pmr::vector<QueryPlanTerm> minus_terms;
+    std::pmr::vector<QueryPlanTerm> scored_terms;   // in evaluation order
+    std::pmr::vector<QueryPlanTerm> dropped_terms;
+    // Set when a dropped word occurs in every document: all documents match,
+    // scored or not, exactly as if its zero contributions had been added.
+    bool matches_all_documents = false;
+
+    // Postings the query reads, not counting phrase and proximity checks
+    size_t GetPostingCount() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryPlan& plan);
@@ -0,0 +1,11 @@
+#include "query_scoring.h"
+#include "ranked_documents.h"
+
+using namespace std;
+
+vector<Document> SelectTopDocuments(pmr::vector<Document>& matched_documents) {
+    const size_t result_count = min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    partial_sort(matched_documents.begin(), matched_documents.begin() + result_count, matched_documents.end(),
+        IsRankedHigher);
+    return vector<Document>(matched_documents.begin(), matched_documents.begin() + result_count);
+}
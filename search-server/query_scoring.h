@@ -0,0 +1,184 @@
+#pragma once
+
+#include "document.h"
+#include "query_plan.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Query planning and the scoring loop shared by SearchServer and
+// SharedIndexSnapshot, so both rank every query the same way. Index is any
+// type with
+//   int GetDocumentCount() const;
+//   double GetAverageDocumentLength() const;
+//   size_t GetWordDocumentCount(std::string_view word) const;   // 0 for unknown words
+//   IndexedDocument GetDocument(int document_id) const;         // or a reference to one
+//   void ForEachPosting(std::string_view word, Callback callback) const;
+//       callback(document_id, term_freq) in ascending id order until it returns
+//       false; only called for words with postings
+//   void ForEachDocument(Callback callback) const;
+//       callback(document_id, const IndexedDocument&) in ascending id order
+//       until it returns false
+
+const int MAX_RESULT_DOCUMENT_COUNT = 5;
+// Asynchronous queries check their deadline and cancellation after every block of postings
+const size_t POSTING_BLOCK_SIZE = 1024;
+
+struct IndexedDocument {
+    int rating;
+    DocumentStatus status;
+    int word_count;  // non-stop words, for length normalization
+};
+
+template <typename Index, typename WordContainer, typename ScoringModel>
+QueryPlan PlanQuery(const Index& index, const WordContainer& plus_words, const WordContainer& minus_words,
+                    const ScoringModel& scoring, std::pmr::memory_resource* resource) {
+    QueryPlan plan(resource);
+    for (const std::string_view word : minus_words) {
+        const size_t document_count = index.GetWordDocumentCount(word);
+        (document_count == 0 ? plan.dropped_terms : plan.minus_terms).push_back({word, document_count, 0.0});
+    }
+    for (const std::string_view word : plus_words) {
+        const size_t document_count = index.GetWordDocumentCount(word);
+        if (document_count == 0) {
+            plan.dropped_terms.push_back({word, 0, 0.0});
+            continue;
+        }
+        const double inverse_document_freq = scoring.ComputeInverseDocumentFreq(index.GetDocumentCount(), document_count);
+        if (inverse_document_freq == 0.0) {
+            plan.dropped_terms.push_back({word, document_count, 0.0});
+            plan.matches_all_documents = true;
+        } else {
+            plan.scored_terms.push_back({word, document_count, inverse_document_freq});
+        }
+    }
+    // words are unique, so the order is fully determined; sort, unlike
+    // stable_sort, needs no temporary buffer from the heap
+    std::sort(plan.scored_terms.begin(), plan.scored_terms.end(), [](const QueryPlanTerm& lhs, const QueryPlanTerm& rhs) {
+        return std::tie(lhs.document_count, lhs.word) < std::tie(rhs.document_count, rhs.word);
+    });
+    return plan;
+}
+
+// Ascending ids of the documents containing a minus word of the plan. Checks
+// should_stop() after every POSTING_BLOCK_SIZE postings and before the sort;
+// once it turns true, sets is_stopped and returns an incomplete set.
+template <typename Index, typename StopPredicate>
+std::pmr::vector<int> CollectExcludedDocuments(const Index& index, const QueryPlan& plan,
+                                               StopPredicate should_stop, bool& is_stopped,
+                                               std::pmr::memory_resource* resource) {
+    std::pmr::vector<int> excluded_documents(resource);
+    size_t postings_until_check = POSTING_BLOCK_SIZE;
+    for (const QueryPlanTerm& term : plan.minus_terms) {
+        index.ForEachPosting(term.word, [&](int document_id, double) {
+            if (--postings_until_check == 0) {
+                postings_until_check = POSTING_BLOCK_SIZE;
+                is_stopped = should_stop();
+            }
+            if (is_stopped) {
+                return false;
+            }
+            excluded_documents.push_back(document_id);
+            return true;
+        });
+        if (is_stopped) {
+            return excluded_documents;
+        }
+    }
+    if (plan.minus_terms.size() > 1) {
+        if (should_stop()) {
+            is_stopped = true;
+            return excluded_documents;
+        }
+        std::sort(excluded_documents.begin(), excluded_documents.end());
+        excluded_documents.erase(std::unique(excluded_documents.begin(), excluded_documents.end()), excluded_documents.end());
+    }
+    return excluded_documents;
+}
+
+template <typename Index>
+std::pmr::vector<int> CollectExcludedDocuments(const Index& index, const QueryPlan& plan, std::pmr::memory_resource* resource) {
+    bool is_stopped = false;
+    return CollectExcludedDocuments(index, plan, [] { return false; }, is_stopped, resource);
+}
+
+// Moves excluded_it forward to document_id; ids must be checked in ascending order
+inline bool IsExcluded(std::pmr::vector<int>::const_iterator& excluded_it,
+                       std::pmr::vector<int>::const_iterator excluded_end, int document_id) {
+    while (excluded_it != excluded_end && *excluded_it < document_id) {
+        ++excluded_it;
+    }
+    return excluded_it != excluded_end && *excluded_it == document_id;
+}
+
+// Adds the relevance of every document matched by the plan to document_to_relevance.
+// Checks should_stop() after every POSTING_BLOCK_SIZE postings or documents and
+// before every term; once it turns true, sets is_stopped and keeps what was scored.
+// A stop while the minus words are read scores nothing, since the set of
+// excluded documents is incomplete.
+template <typename Index, typename ScoringModel, typename DocumentPredicate, typename StopPredicate>
+void ScoreDocuments(const Index& index, const QueryPlan& plan, const ScoringModel& scoring,
+                    DocumentPredicate document_predicate, StopPredicate should_stop, bool& is_stopped,
+                    std::pmr::map<int, double>& document_to_relevance) {
+    if (plan.scored_terms.empty() && !plan.matches_all_documents) {
+        return;
+    }
+    const auto excluded_documents = CollectExcludedDocuments(index, plan, should_stop, is_stopped,
+                                                             document_to_relevance.get_allocator().resource());
+    if (is_stopped) {
+        return;
+    }
+
+    size_t postings_until_check = POSTING_BLOCK_SIZE;
+    auto is_stop_due = [&] {
+        if (--postings_until_check == 0) {
+            postings_until_check = POSTING_BLOCK_SIZE;
+            is_stopped = should_stop();
+        }
+        return is_stopped;
+    };
+
+    if (plan.matches_all_documents) {
+        auto excluded_it = excluded_documents.begin();
+        index.ForEachDocument([&](int document_id, const IndexedDocument& document) {
+            if (is_stop_due()) {
+                return false;
+            }
+            if (!IsExcluded(excluded_it, excluded_documents.end(), document_id)
+                && document_predicate(document_id, document.status, document.rating)) {
+                document_to_relevance.emplace_hint(document_to_relevance.end(), document_id, 0.0);
+            }
+            return true;
+        });
+    }
+
+    const auto scorer = scoring.CreateScorer(index.GetAverageDocumentLength());
+    for (const QueryPlanTerm& term : plan.scored_terms) {
+        if (is_stopped || should_stop()) {
+            is_stopped = true;
+            break;
+        }
+        auto excluded_it = excluded_documents.begin();
+        index.ForEachPosting(term.word, [&](int document_id, double term_freq) {
+            if (is_stop_due()) {
+                return false;
+            }
+            if (IsExcluded(excluded_it, excluded_documents.end(), document_id)) {
+                return true;
+            }
+            const auto& document = index.GetDocument(document_id);
+            if (document_predicate(document_id, document.status, document.rating)) {
+                document_to_relevance[document_id] += scorer(term_freq, term.inverse_document_freq, document.word_count);
+            }
+            return true;
+        });
+    }
+}
+
+// The best MAX_RESULT_DOCUMENT_COUNT documents, reordering matched_documents
+std::vector<Document> SelectTopDocuments(std::pmr::vector<Document>& matched_documents);
@@ -0,0 +1,41 @@
+#include "ranked_documents.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// std heap functions keep the greatest element in front
+bool IsRankedLower(const Document& lhs, const Document& rhs) {
+    return IsRankedHigher(rhs, lhs);
+}
+
+} // namespace
+
+RankedDocuments::RankedDocuments(vector<Document> documents)
+    : heap_(move(documents))
+{
+    make_heap(heap_.begin(), heap_.end(), IsRankedLower);
+}
+
+RankedDocuments::Iterator RankedDocuments::begin() {
+    return Iterator(this);
+}
+
+RankedDocuments::Iterator RankedDocuments::end() {
+    return Iterator(nullptr);
+}
+
+bool RankedDocuments::empty() const {
+    return heap_.empty();
+}
+
+size_t RankedDocuments::size() const {
+    return heap_.size();
+}
+
+void RankedDocuments::Pop() {
+    pop_heap(heap_.begin(), heap_.end(), IsRankedLower);
+    heap_.pop_back();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "document.h"
+
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+const double EPSILON = 1e-6;
+
+// Ranking order of search results: by relevance, then by rating.
+inline bool IsRankedHigher(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+// Single-pass range yielding matched documents in ranking order. Ordering is
+// done lazily with a binary heap, so reading k of n documents costs
+// O(n + k log n) instead of sorting everything.
+class RankedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        explicit Iterator(RankedDocuments* owner)
+            : owner_(owner)
+        {
+        }
+
+        reference operator*() const {
+            return owner_->heap_.front();
+        }
+        pointer operator->() const {
+            return &owner_->heap_.front();
+        }
+
+        Iterator& operator++() {
+            owner_->Pop();
+            return *this;
+        }
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return IsEnd() == other.IsEnd();
+        }
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        RankedDocuments* owner_;
+
+        bool IsEnd() const {
+            return owner_ == nullptr || owner_->heap_.empty();
+        }
+    };
+
+    explicit RankedDocuments(std::vector<Document> documents);
+
+    Iterator begin();
+    Iterator end();
+
+    bool empty() const;
+    // Documents not yet read
+    size_t size() const;
+
+private:
+    std::vector<Document> heap_;
+
+    void Pop();
+};
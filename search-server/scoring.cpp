@@ -0,0 +1,19 @@
+#include "scoring.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+double Bm25Scoring::ComputeInverseDocumentFreq(int document_count, size_t word_document_count) const {
+    const double word_documents = static_cast<double>(word_document_count);
+    return log(1.0 + (document_count - word_documents + 0.5) / (word_documents + 0.5));
+}
+
+Bm25Scoring::Scorer Bm25Scoring::CreateScorer(double average_document_length) const {
+    if (!(k1 >= 0.0) || !(b >= 0.0 && b <= 1.0)) {
+        throw invalid_argument("BM25 needs k1 >= 0 and b in [0, 1]"s);
+    }
+    const double length_weight = average_document_length > 0.0 ? k1 * b / average_document_length : 0.0;
+    return {k1, k1 * (1.0 - b), length_weight};
+}
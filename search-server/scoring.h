@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Ranking models for SearchServer::FindTopDocuments. The model is a template
+// argument of the scoring loop, so every model gets its own instantiation and
+// the default TF-IDF loop carries no trace of the others. A model provides
+//   double ComputeInverseDocumentFreq(int document_count, size_t word_document_count) const;
+//       weight of a word; 0 means the word changes no relevance
+//   Scorer CreateScorer(double average_document_length) const;
+//       per-query object with everything that does not depend on the posting:
+//       double operator()(double term_freq, double inverse_document_freq, int document_length) const
+// term_freq is the share of the document's non-stop words taken by the query
+// word, document_length is the number of those words.
+
+struct TfIdfScoring {
+    struct Scorer {
+        double operator()(double term_freq, double inverse_document_freq, int) const {
+            return term_freq * inverse_document_freq;
+        }
+    };
+
+    double ComputeInverseDocumentFreq(int document_count, size_t word_document_count) const {
+        return std::log(document_count * 1.0 / static_cast<double>(word_document_count));
+    }
+
+    Scorer CreateScorer(double) const {
+        return {};
+    }
+};
+
+// Okapi BM25 with the non-negative IDF used by Lucene.
+// k1 limits how much repeated words add, b sets how strongly long documents are penalized.
+struct Bm25Scoring {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    struct Scorer {
+        double k1;
+        double length_base;    // k1 * (1 - b)
+        double length_weight;  // k1 * b / average document length
+
+        double operator()(double term_freq, double inverse_document_freq, int document_length) const {
+            const double word_count = term_freq * document_length;
+            return inverse_document_freq * word_count * (k1 + 1.0)
+                / (word_count + length_base + length_weight * document_length);
+        }
+    };
+
+    double ComputeInverseDocumentFreq(int document_count, size_t word_document_count) const;
+
+    // Throws invalid_argument unless k1 >= 0 and 0 <= b <= 1
+    Scorer CreateScorer(double average_document_length) const;
+};
+
+template <typename T, typename = void>
+struct IsScoringModel : std::false_type {};
+
+template <typename T>
+struct IsScoringModel<T, std::void_t<decltype(std::declval<const T&>().CreateScorer(1.0))>> : std::true_type {};
@@ -1,14 +1,25 @@
 #include "search_server.h"
 
+#include <limits>
+#include <numeric>
 #include <stdexcept>
 
 using namespace std;
 
-SearchServer::SearchServer(const string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text)) {}
+namespace {
 
-SearchServer::SearchServer(string_view stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text.data())) {}
+// States of a document while a batch query is scored
+const uint8_t BATCH_NOT_MATCHED = 0;
+const uint8_t BATCH_MATCHED = 1;
+const uint8_t BATCH_EXCLUDED = 2;
+
+} // namespace
+
+SearchServer::SearchServer(const string& stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text), options) {}
+
+SearchServer::SearchServer(string_view stop_words_text, const SearchServerOptions& options)
+    : SearchServer(SplitIntoWords(stop_words_text.data()), options) {}
 
 SearchServer::Iterator SearchServer::begin() {
     return document_ids_.begin();
@@ -35,18 +46,73 @@ SearchServer::ConstIterator SearchServer::cend() const {
 }
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    AddDocument(document_id, SplitIntoWordViews(document), status, ratings);
+}
+
+void SearchServer::AddDocument(int document_id, const vector<string_view>& words, DocumentStatus status, const vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    const auto words = SplitIntoWordsNoStop(document.data());
+    vector<string_view> words_no_stop;
+    // positions count stop words too, so phrases keep their gaps; they are
+    // only collected when the server stores them
+    vector<uint32_t> positions;
+    words_no_stop.reserve(words.size());
+    if (options_.store_positions) {
+        positions.reserve(words.size());
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (!IsValidWord(words[i])) {
+            throw invalid_argument("Word "s + string(words[i]) + " is invalid"s);
+        }
+        if (!IsStopWord(words[i])) {
+            words_no_stop.push_back(words[i]);
+            if (options_.store_positions) {
+                positions.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
 
-    const double inv_word_count = 1.0 / static_cast<double>(words.size());
-    for (const string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        id_to_word_freqs_[document_id][word] += inv_word_count;
+    const double inv_word_count = 1.0 / static_cast<double>(words_no_stop.size());
+    // (index key, position) of every word, grouped by word below
+    vector<pair<string_view, uint32_t>> word_positions;
+    if (options_.store_positions) {
+        word_positions.reserve(words_no_stop.size());
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    for (size_t i = 0; i < words_no_stop.size(); ++i) {
+        const string_view word = words_no_stop[i];
+        auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            it = word_to_document_freqs_.emplace(string(word), map<int, TermFrequency>{}).first;
+        }
+        if (it->second.empty()) {
+            dictionary_.Insert(word);
+        }
+        // id_to_word_freqs_ keys must view the long-lived copy of the word
+        it->second[document_id] += static_cast<TermFrequency>(inv_word_count);
+        id_to_word_freqs_[document_id][it->first] += static_cast<TermFrequency>(inv_word_count);
+        if (options_.store_positions) {
+            word_positions.push_back({it->first, positions[i]});
+        }
+    }
+    if (options_.store_positions) {
+        sort(word_positions.begin(), word_positions.end());
+        vector<uint32_t> document_positions;
+        for (size_t begin = 0; begin < word_positions.size();) {
+            const string_view word = word_positions[begin].first;
+            document_positions.clear();
+            size_t end = begin;
+            for (; end < word_positions.size() && word_positions[end].first == word; ++end) {
+                document_positions.push_back(word_positions[end].second);
+            }
+            word_to_document_positions_[word].Add(document_id, document_positions);
+            begin = end;
+        }
+    }
+    const int word_count = static_cast<int>(words_no_stop.size());
+    documents_.emplace(document_id, IndexedDocument{ComputeAverageRating(ratings), status, word_count});
     document_ids_.push_back(document_id);
+    total_word_count_ += word_count;
 }
 
 vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
@@ -60,6 +126,42 @@ vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
         return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries, DocumentStatus status) const {
+    return FindTopDocumentsBatch(
+        raw_queries, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+vector<vector<Document>> SearchServer::FindTopDocumentsBatch(const vector<string>& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+RankedDocuments SearchServer::FindRankedDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindRankedDocuments(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+RankedDocuments SearchServer::FindRankedDocuments(string_view raw_query) const {
+    return FindRankedDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+future<AsyncSearchResult> SearchServer::FindTopDocumentsAsync(string raw_query, DocumentStatus status,
+                                                              SearchControl control, QueryExecutor& executor) const {
+    return FindTopDocumentsAsync(
+        move(raw_query), [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        },
+        move(control), executor);
+}
+
+future<AsyncSearchResult> SearchServer::FindTopDocumentsAsync(string raw_query, SearchControl control,
+                                                              QueryExecutor& executor) const {
+    return FindTopDocumentsAsync(move(raw_query), DocumentStatus::ACTUAL, move(control), executor);
+}
+
     int SearchServer::GetDocumentCount() const {
         return static_cast<int>(documents_.size());
 }
@@ -72,23 +174,29 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_vi
     if (id_to_word_freqs_.find(document_id) == id_to_word_freqs_.end()) {
         throw out_of_range("Invalid document id"s);
     }
-    const auto query = ParseQuery(raw_query.data());
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
 
     vector<string_view> matched_words;
-    for (const string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    matched_words.reserve(query.plus_words.size());
+    for (const string_view word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        // the query is destroyed on return, so the result views the indexed copy
+        if (it != word_to_document_freqs_.end() && it->second.count(document_id)) {
+            matched_words.push_back(it->first);
         }
     }
 
-    for (const string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    for (const string_view word : query.minus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end() && it->second.count(document_id)) {
+            matched_words.clear();
+            break;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
+    }
+
+    for (const Phrase& phrase : query.phrases) {
+        if (!ContainsPhrase(document_id, phrase)) {
             matched_words.clear();
             break;
         }
@@ -97,8 +205,8 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(string_vi
     return {matched_words, documents_.at(document_id).status};
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static map<string_view, double> empty_map;    
+const map<string_view, TermFrequency>& SearchServer::GetWordFrequencies(int document_id) const {
+    static map<string_view, TermFrequency> empty_map;    
     auto it = id_to_word_freqs_.find(document_id);
     if (it != id_to_word_freqs_.end()) {
         return it->second;
@@ -112,37 +220,240 @@ void SearchServer::RemoveDocument(int document_id) {
     if (it == id_to_word_freqs_.end()) return;
     
     for (auto [word, frequency] : it->second) {
-        word_to_document_freqs_.at(word.data()).erase(document_id);
+        auto& document_freqs = word_to_document_freqs_.find(word)->second;
+        document_freqs.erase(document_id);
+        if (document_freqs.empty()) {
+            dictionary_.Erase(word);
+        }
+        if (options_.store_positions) {
+            word_to_document_positions_.at(word).Erase(document_id);
+        }
     }
 
     id_to_word_freqs_.erase(document_id);
+    total_word_count_ -= documents_.at(document_id).word_count;
     documents_.erase(document_id);
 
     auto iterator = find(begin(), end(), document_id);
     document_ids_.erase(iterator);
 }
 
-bool SearchServer::IsStopWord(const string& word) const {
-    return stop_words_.count(word) > 0;
+SearchServerStats SearchServer::GetStats() const {
+    SearchServerStats stats;
+    IndexStats& index = stats.index;
+    index.document_count = documents_.size();
+    index.vocabulary_size = word_to_document_freqs_.size();
+
+    index.word_to_document_freqs_bytes = ApproximateMapBytes(word_to_document_freqs_);
+    for (const auto& [word, document_freqs] : word_to_document_freqs_) {
+        index.posting_count += document_freqs.size();
+        if (word.capacity() > string().capacity()) {
+            index.word_to_document_freqs_bytes += word.capacity() + 1;
+        }
+        index.word_to_document_freqs_bytes += ApproximateMapBytes(document_freqs);
+    }
+
+    index.id_to_word_freqs_bytes = ApproximateMapBytes(id_to_word_freqs_);
+    for (const auto& [document_id, word_freqs] : id_to_word_freqs_) {
+        index.id_to_word_freqs_bytes += ApproximateMapBytes(word_freqs);
+    }
+
+    index.positions_bytes = ApproximateMapBytes(word_to_document_positions_);
+    for (const auto& [word, positions] : word_to_document_positions_) {
+        index.positions_bytes += positions.GetByteSize();
+    }
+
+    index.term_dictionary_bytes = dictionary_.GetByteSize();
+    index.documents_bytes = ApproximateMapBytes(documents_);
+    index.document_ids_bytes = document_ids_.capacity() * sizeof(int);
+
+    for (size_t i = 0; i < QUERY_STAGE_COUNT; ++i) {
+        stats.stages[i] = metrics_.GetStageSummary(static_cast<QueryStage>(i));
+    }
+    stats.postings_scanned = metrics_.GetPostingsScanned();
+    stats.documents_matched = metrics_.GetDocumentsMatched();
+    return stats;
 }
 
-bool SearchServer::IsValidWord(const string& word) {
-    return none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-    });
+SearchServer::IndexExport SearchServer::ExportIndex() const {
+    return {word_to_document_freqs_, stop_words_, documents_};
 }
 
-vector<string> SearchServer::SplitIntoWordsNoStop(const string& text) const {
-    vector<string> words;
-    for (const string& word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + word + " is invalid"s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+vector<vector<Document>> SearchServer::ScoreQueryBatch(const vector<string>& raw_queries,
+                                                       const vector<char>& is_included) const {
+    // Parse and plan everything first, so an invalid query throws before any work
+    // is done. Plans give the IDF of every scored word, which is the same in all
+    // queries of the batch.
+    vector<Query> queries;
+    vector<QueryPlan> plans;
+    queries.reserve(raw_queries.size());
+    plans.reserve(raw_queries.size());
+    for (const string& raw_query : raw_queries) {
+        queries.push_back(ParseQuery(raw_query, pmr::get_default_resource()));
+        plans.push_back(PlanQuery(IndexView(*this), queries.back().plus_words, queries.back().minus_words, TfIdfScoring{},
+                                  pmr::get_default_resource()));
+    }
+
+    vector<int> document_ids;
+    vector<int> document_ratings;
+    document_ids.reserve(documents_.size());
+    document_ratings.reserve(documents_.size());
+    for (const auto& [document_id, document_data] : documents_) {
+        document_ids.push_back(document_id);
+        document_ratings.push_back(document_data.rating);
+    }
+
+    vector<vector<Document>> results(queries.size());
+    for (size_t group_begin = 0; group_begin < queries.size();) {
+        // Consecutive queries join the group while its distinct words hold at most
+        // MAX_BATCH_POSTINGS postings; a larger query makes a group of its own.
+        map<string_view, double> word_to_inverse_document_freq;
+        size_t posting_count = 0;
+        size_t group_end = group_begin;
+        for (; group_end < queries.size(); ++group_end) {
+            const QueryPlan& plan = plans[group_end];
+            vector<string_view> added_words;
+            size_t added_posting_count = 0;
+            for (const auto* terms : {&plan.minus_terms, &plan.scored_terms}) {
+                for (const QueryPlanTerm& term : *terms) {
+                    if (word_to_inverse_document_freq.emplace(term.word, 0.0).second) {
+                        added_words.push_back(term.word);
+                        added_posting_count += term.document_count;
+                    }
+                }
+            }
+            if (group_end > group_begin && posting_count + added_posting_count > MAX_BATCH_POSTINGS) {
+                for (const string_view word : added_words) {
+                    word_to_inverse_document_freq.erase(word);
+                }
+                break;
+            }
+            posting_count += added_posting_count;
+            for (const QueryPlanTerm& term : plan.scored_terms) {
+                word_to_inverse_document_freq[term.word] = term.inverse_document_freq;
+            }
         }
+        ScoreQueryGroup(queries, plans, group_begin, group_end, word_to_inverse_document_freq,
+                        document_ids, document_ratings, is_included, results);
+        group_begin = group_end;
     }
-    return words;
+    return results;
+}
+
+void SearchServer::ScoreQueryGroup(const vector<Query>& queries, const vector<QueryPlan>& plans,
+                                   size_t query_begin, size_t query_end,
+                                   const map<string_view, double>& word_to_inverse_document_freq,
+                                   const vector<int>& document_ids, const vector<int>& document_ratings,
+                                   const vector<char>& is_included, vector<vector<Document>>& results) const {
+    // Every posting list of the group is walked once; contributions are the
+    // TF-IDF terms FindAllDocuments would add for the same posting.
+    const vector<pair<string_view, double>> words(word_to_inverse_document_freq.begin(), word_to_inverse_document_freq.end());
+    vector<vector<BatchPosting>> word_postings(words.size());
+    transform(execution::par, words.begin(), words.end(), word_postings.begin(), [&](const auto& word) {
+        const auto& document_freqs = word_to_document_freqs_.find(word.first)->second;
+        metrics_.AddPostingsScanned(document_freqs.size());
+        vector<BatchPosting> postings;
+        postings.reserve(document_freqs.size());
+        auto document_it = document_ids.begin();
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            document_it = lower_bound(document_it, document_ids.end(), document_id);
+            postings.push_back({static_cast<uint32_t>(document_it - document_ids.begin()), term_freq * word.second});
+        }
+        return postings;
+    });
+    auto get_postings = [&](string_view word) -> const vector<BatchPosting>& {
+        const auto it = lower_bound(words.begin(), words.end(), word, [](const auto& lhs, string_view rhs) {
+            return lhs.first < rhs;
+        });
+        return word_postings[it - words.begin()];
+    };
+
+    vector<size_t> chunks((query_end - query_begin + QUERY_BATCH_CHUNK_SIZE - 1) / QUERY_BATCH_CHUNK_SIZE);
+    iota(chunks.begin(), chunks.end(), 0);
+    for_each(execution::par, chunks.begin(), chunks.end(), [&](size_t chunk) {
+        // Dense accumulators indexed like documents_; only the touched entries are
+        // reset between queries. Each query adds its terms in its own plan order,
+        // so every relevance is summed exactly as in FindAllDocuments.
+        vector<double> relevances(document_ids.size());
+        vector<uint8_t> states(document_ids.size(), BATCH_NOT_MATCHED);
+        vector<uint32_t> matched_indexes;
+        vector<uint32_t> excluded_indexes;
+        pmr::vector<Document> matched_documents;
+
+        const size_t chunk_begin = query_begin + chunk * QUERY_BATCH_CHUNK_SIZE;
+        const size_t chunk_end = min(query_end, chunk_begin + QUERY_BATCH_CHUNK_SIZE);
+        for (size_t query_index = chunk_begin; query_index < chunk_end; ++query_index) {
+            const Query& query = queries[query_index];
+            const QueryPlan& plan = plans[query_index];
+            if (plan.scored_terms.empty() && !plan.matches_all_documents) {
+                continue;
+            }
+
+            for (const QueryPlanTerm& term : plan.minus_terms) {
+                for (const BatchPosting& posting : get_postings(term.word)) {
+                    states[posting.document_index] = BATCH_EXCLUDED;
+                    excluded_indexes.push_back(posting.document_index);
+                }
+            }
+            if (plan.matches_all_documents) {
+                for (uint32_t index = 0; index < document_ids.size(); ++index) {
+                    if (is_included[index] && states[index] == BATCH_NOT_MATCHED) {
+                        states[index] = BATCH_MATCHED;
+                        relevances[index] = 0.0;
+                        matched_indexes.push_back(index);
+                    }
+                }
+            }
+            for (const QueryPlanTerm& term : plan.scored_terms) {
+                for (const BatchPosting& posting : get_postings(term.word)) {
+                    const uint32_t index = posting.document_index;
+                    if (states[index] == BATCH_NOT_MATCHED) {
+                        if (!is_included[index]) {
+                            continue;
+                        }
+                        states[index] = BATCH_MATCHED;
+                        relevances[index] = 0.0;
+                        matched_indexes.push_back(index);
+                    } else if (states[index] == BATCH_EXCLUDED) {
+                        continue;
+                    }
+                    relevances[index] += posting.contribution;
+                }
+            }
+
+            // partial_sort is not stable: documents go in by ascending id, as from the relevance map
+            sort(matched_indexes.begin(), matched_indexes.end());
+            matched_documents.clear();
+            if (NeedsPositionalRanking(query)) {
+                pmr::map<int, double> document_to_relevance;
+                for (const uint32_t index : matched_indexes) {
+                    document_to_relevance.emplace_hint(document_to_relevance.end(), document_ids[index], relevances[index]);
+                }
+                ApplyPositionalRanking(query, document_to_relevance);
+                for (const auto& [document_id, relevance] : document_to_relevance) {
+                    matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+                }
+            } else {
+                for (const uint32_t index : matched_indexes) {
+                    matched_documents.push_back({document_ids[index], relevances[index], document_ratings[index]});
+                }
+            }
+            metrics_.AddDocumentsMatched(matched_documents.size());
+            results[query_index] = SelectTopDocuments(matched_documents);
+
+            for (const auto* indexes : {&matched_indexes, &excluded_indexes}) {
+                for (const uint32_t index : *indexes) {
+                    states[index] = BATCH_NOT_MATCHED;
+                }
+            }
+            matched_indexes.clear();
+            excluded_indexes.clear();
+        }
+    });
+}
+
+bool SearchServer::IsStopWord(string_view word) const {
+    return stop_words_.count(word) > 0;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
@@ -156,38 +467,138 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
-    if (text.empty()) {
-        throw std::invalid_argument("Query word is empty"s);
+void SearchServer::ParsePhrase(string_view text, Query& query) const {
+    Phrase phrase(query.phrases.get_allocator().resource());
+    uint32_t offset = 0;
+    for (size_t pos = text.find_first_not_of(' '); pos != string_view::npos; pos = text.find_first_not_of(' ', pos)) {
+        const size_t word_end = min(text.find(' ', pos), text.size());
+        const QueryToken token = ParseQueryToken(text.substr(pos, word_end - pos));
+        pos = word_end;
+        if (token.is_minus) {
+            throw invalid_argument("Minus words are not allowed inside a phrase"s);
+        }
+        if (token.word.find('*') != string_view::npos || FindFuzzySuffix(token.word) != string_view::npos) {
+            throw invalid_argument("Wildcard and fuzzy words are not allowed inside a phrase"s);
+        }
+        if (!IsStopWord(token.word)) {
+            query.plus_words.insert(token.word);
+            phrase.words.push_back({token.word, offset});
+        }
+        ++offset;
     }
-    std::string word = text;
-    bool is_minus = false;
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
+    // a single word needs no position check
+    if (phrase.words.size() < 2) {
+        return;
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word "s + text + " is invalid");
+    if (!options_.store_positions) {
+        throw invalid_argument("Phrase queries require store_positions"s);
     }
-
-    return {word, is_minus, IsStopWord(word)};
+    const uint32_t first_offset = phrase.words.front().second;
+    for (auto& [word, word_offset] : phrase.words) {
+        word_offset -= first_offset;
+    }
+    query.phrases.push_back(move(phrase));
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
-    Query result;
-    for (const std::string& word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
-            } else {
-                result.plus_words.insert(query_word.data);
+SearchServer::Query SearchServer::ParseQuery(string_view text, pmr::memory_resource* resource) const {
+    Query result(resource);
+    ForEachQueryToken(
+        text,
+        [this, &result](const QueryToken& token) {
+            if (!IsStopWord(token.word)) {
+                ExpandQueryWord(token.word, token.is_minus, token.is_minus ? result.minus_words : result.plus_words);
             }
+        },
+        [this, &result](string_view phrase) {
+            ParsePhrase(phrase, result);
+        });
+    return result;
+}
+
+void SearchServer::ExpandQueryWord(string_view word, bool is_minus, pmr::set<string_view>& words) const {
+    const size_t max_count = is_minus ? numeric_limits<size_t>::max() : MAX_TERM_EXPANSIONS;
+    TermDictionary::Lookup expansions;
+    const size_t fuzzy_suffix = FindFuzzySuffix(word);
+    if (fuzzy_suffix != string_view::npos) {
+        const int distance = fuzzy_suffix + 1 == word.size() ? 1 : word[fuzzy_suffix + 1] - '0';
+        if (word.size() > fuzzy_suffix + 2 || distance > MAX_EDIT_DISTANCE) {
+            throw invalid_argument("Edit distance of "s + string(word) + " is too large"s);
         }
+        expansions.words = dictionary_.FindSimilar(word.substr(0, fuzzy_suffix), distance, max_count);
+    } else if (word.find('*') + 1 == word.size()) {
+        // a single trailing '*' needs no pattern matching below the prefix node
+        expansions = dictionary_.FindByPrefix(word.substr(0, word.size() - 1), max_count, MAX_TERM_LOOKUP_NODES);
+    } else if (word.find('*') != string_view::npos) {
+        expansions = dictionary_.FindByPattern(word, max_count, MAX_TERM_LOOKUP_NODES);
+    } else {
+        words.insert(word);
+        return;
     }
-    return result;
+    if (is_minus && expansions.is_truncated) {
+        throw invalid_argument("Minus word "s + string(word) + " needs too long a dictionary lookup"s);
+    }
+    // expansions are temporary, the index keeps a copy of every word
+    for (const string& expansion : expansions.words) {
+        words.insert(word_to_document_freqs_.find(expansion)->first);
+    }
+}
+
+QueryPlan SearchServer::ExplainQuery(string_view raw_query) const {
+    QueryArena arena;
+    const Query query = ParseQuery(raw_query, arena.GetResource());
+    return PlanQuery(IndexView(*this), query.plus_words, query.minus_words, TfIdfScoring{}, pmr::get_default_resource());
+}
+
+double SearchServer::GetAverageDocumentLength() const {
+    return documents_.empty() ? 0.0 : static_cast<double>(total_word_count_) / static_cast<double>(documents_.size());
+}
+
+vector<uint32_t> SearchServer::GetWordPositions(string_view word, int document_id) const {
+    const auto word_it = word_to_document_positions_.find(word);
+    if (word_it == word_to_document_positions_.end()) {
+        return {};
+    }
+    return word_it->second.Decode(document_id);
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / static_cast<double>(word_to_document_freqs_.at(word).size()));
-}
\ No newline at end of file
+bool SearchServer::ContainsPhrase(int document_id, const Phrase& phrase) const {
+    vector<vector<uint32_t>> positions;
+    positions.reserve(phrase.words.size());
+    for (const auto& [word, offset] : phrase.words) {
+        positions.push_back(GetWordPositions(word, document_id));
+        if (positions.back().empty()) {
+            return false;
+        }
+    }
+    for (const uint32_t start : positions.front()) {
+        bool is_match = true;
+        for (size_t i = 1; i < positions.size() && is_match; ++i) {
+            is_match = binary_search(positions[i].begin(), positions[i].end(), start + phrase.words[i].second);
+        }
+        if (is_match) {
+            return true;
+        }
+    }
+    return false;
+}
+
+double SearchServer::ComputeProximityBoost(int document_id, const Query& query) const {
+    vector<vector<uint32_t>> positions;
+    for (const string_view word : query.plus_words) {
+        auto word_positions = GetWordPositions(word, document_id);
+        if (!word_positions.empty()) {
+            positions.push_back(move(word_positions));
+        }
+    }
+    const uint32_t distance = ComputeMinimalWordDistance(positions);
+    return distance == 0 ? 1.0 : 1.0 + PROXIMITY_WEIGHT / distance;
+}
+
+bool SearchServer::NeedsPositionalRanking(const Query& query) const {
+    return !query.phrases.empty() || (options_.proximity_ranking && query.plus_words.size() > 1);
+}
+
+void SearchServer::ApplyPositionalRanking(const Query& query, pmr::map<int, double>& document_to_relevance) const {
+    bool is_stopped = false;
+    ApplyPositionalRanking(query, document_to_relevance, [] { return false; }, is_stopped);
+}
@@ -2,30 +2,93 @@
 
 #include "concurrent_map.h"
 #include "document.h"
+#include "instrumentation.h"
+#include "positional_index.h"
+#include "query_arena.h"
+#include "query_executor.h"
+#include "query_plan.h"
+#include "query_scoring.h"
+#include "ranked_documents.h"
+#include "scoring.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <execution>
+#include <future>
 #include <map>
+#include <memory_resource>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 using namespace std::literals;
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+// Relevance boost of proximity ranking for query words standing side by side;
+// it falls off as 1 / distance.
+const double PROXIMITY_WEIGHT = 0.5;
+// Lock stripes of the relevance map in parallel queries
+const size_t MAX_RELEVANCE_BUCKET_COUNT = 128;
+// A wildcard ("cat*", "c*t") or fuzzy ("cat~", "cat~2") plus word is replaced
+// by at most this many indexed words. A minus word is replaced by every match,
+// since a dropped match would let its documents through.
+const size_t MAX_TERM_EXPANSIONS = 32;
+// Trie nodes one wildcard word may examine. A plus word keeps the
+// matches found within the budget; a minus word that runs out of it is
+// rejected, because its matches must all be excluded.
+const size_t MAX_TERM_LOOKUP_NODES = 8192;
+const int MAX_EDIT_DISTANCE = 2;
+// Queries of a batch scored one after another with the same accumulators
+const size_t QUERY_BATCH_CHUNK_SIZE = 64;
+// Postings a batch copies at a time, 16 bytes each; bounds the memory of a
+// large batch regardless of how many queries and words it has
+const size_t MAX_BATCH_POSTINGS = 1 << 20;
+
+// SEARCH_SERVER_COMPACT_TF stores term frequencies as float, which makes every
+// node of the posting maps in word_to_document_freqs_ 8 bytes smaller. The
+// per-document maps in id_to_word_freqs_ do not shrink: a pair of string_view
+// and float is padded to the size of one with double. Relevance is still
+// accumulated in double, so rankings stay within EPSILON of the default build.
+#ifdef SEARCH_SERVER_COMPACT_TF
+using TermFrequency = float;
+#else
+using TermFrequency = double;
+#endif
+
+struct AsyncSearchResult {
+    std::vector<Document> documents;
+    // Set when the query was stopped early: documents are the best ones among
+    // the postings read so far, with relevance summed over those postings.
+    bool is_partial = false;
+};
+
+struct SearchServerOptions {
+    // Keeps word positions in a separate index; needed for "quoted phrase"
+    // queries and proximity ranking. Queries without phrases never read it.
+    bool store_positions = false;
+    // Multiplies relevance by 1 + PROXIMITY_WEIGHT / distance, where distance is
+    // the smallest gap between two different query words in the document.
+    bool proximity_ranking = false;
+};
+
+template <typename ExecutionPolicy>
+using EnableForExecutionPolicy = std::enable_if_t<std::is_execution_policy_v<std::decay_t<ExecutionPolicy>>, bool>;
+
+template <typename ScoringModel>
+using EnableForScoringModel = std::enable_if_t<IsScoringModel<ScoringModel>::value, bool>;
 
 class SearchServer {
 public:
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
-    explicit SearchServer(const std::string& stop_words_text);
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(const StringContainer& stop_words, const SearchServerOptions& options = {});
+    explicit SearchServer(const std::string& stop_words_text, const SearchServerOptions& options = {});
+    explicit SearchServer(std::string_view stop_words_text, const SearchServerOptions& options = {});
 
     using Iterator = std::vector<int>::iterator;
     using ConstIterator = std::vector<int>::const_iterator;
@@ -37,21 +100,67 @@ public:
     ConstIterator cend() const;
     
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Adds a document that is already split into words, e.g. by the bulk loader;
+    // stop words are filtered out here as usual.
+    void AddDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
 
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const ;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
-    template <typename ExecutionPolicy, typename DocumentPredicate>
+    template <typename ExecutionPolicy, typename DocumentPredicate, EnableForExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
 
-    template <typename ExecutionPolicy>
+    template <typename ExecutionPolicy, EnableForExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const ;
 
-    template <typename ExecutionPolicy>
+    template <typename ExecutionPolicy, EnableForExecutionPolicy<ExecutionPolicy> = true>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const;
 
+    // Ranks with the given model, e.g. Bm25Scoring{}; the overloads without
+    // one use TfIdfScoring.
+    template <typename ScoringModel, typename DocumentPredicate, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename ScoringModel, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename ScoringModel, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query) const;
+
+    // Same results as FindTopDocuments for every query, in the order of raw_queries.
+    // Postings of each distinct word are read once into a flat list of
+    // (document, contribution) pairs shared by all queries with that word. Long
+    // batches are split into groups of queries copying at most MAX_BATCH_POSTINGS
+    // postings, and each group's copy is freed before the next one is read.
+    // Throws invalid_argument before any scoring if a query is invalid.
+    template <typename DocumentPredicate>
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentPredicate document_predicate) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                             DocumentStatus status) const;
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const;
+
+    // All matched documents, ordered lazily while they are read. Every match is
+    // still scored and copied up front; only the sorting is deferred, so reading
+    // a few pages saves the cost of ordering the rest, not of finding them.
+    template <typename DocumentPredicate>
+    RankedDocuments FindRankedDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    RankedDocuments FindRankedDocuments(std::string_view raw_query, DocumentStatus status) const;
+    RankedDocuments FindRankedDocuments(std::string_view raw_query) const;
+
+    // Runs the query on the executor; the server must outlive the returned future.
+    template <typename DocumentPredicate>
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate,
+                                                         SearchControl control = {},
+                                                         QueryExecutor& executor = QueryExecutor::GetShared()) const;
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status,
+                                                         SearchControl control = {},
+                                                         QueryExecutor& executor = QueryExecutor::GetShared()) const;
+    std::future<AsyncSearchResult> FindTopDocumentsAsync(std::string raw_query, SearchControl control = {},
+                                                         QueryExecutor& executor = QueryExecutor::GetShared()) const;
+
     int GetDocumentCount() const;
     int GetDocumentId(int index) const;
 
@@ -60,107 +169,282 @@ public:
     template <typename ExecutionPolicy>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const ExecutionPolicy& policy, std::string_view raw_query, int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    const std::map<std::string_view, TermFrequency>& GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(int document_id);
 
     template <typename ExecutionPolicy>
     void RemoveDocument(const ExecutionPolicy& policy, int document_id);
 
+    // How the query would be evaluated: term order, excluded and dropped words.
+    // Words of the plan view raw_query and the index.
+    QueryPlan ExplainQuery(std::string_view raw_query) const;
+
+    // Index size and query latency snapshot; latencies stay zero unless
+    // the server is built with SEARCH_SERVER_ENABLE_STATS.
+    SearchServerStats GetStats() const;
+
+    // Read-only view of the whole index for exporters such as SharedIndexPublisher.
+    // Words are in ascending order and may have no postings left after removals.
+    struct IndexExport {
+        const std::map<std::string, std::map<int, TermFrequency>, std::less<>>& word_to_document_freqs;
+        const std::set<std::string, std::less<>>& stop_words;
+        const std::map<int, IndexedDocument>& documents;
+    };
+    IndexExport ExportIndex() const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    // The Index of query_scoring.h over this server; counts the postings it reads.
+    class IndexView {
+    public:
+        explicit IndexView(const SearchServer& server)
+            : server_(server) {}
+
+        int GetDocumentCount() const {
+            return server_.GetDocumentCount();
+        }
+
+        double GetAverageDocumentLength() const {
+            return server_.GetAverageDocumentLength();
+        }
+
+        size_t GetWordDocumentCount(std::string_view word) const {
+            const auto it = server_.word_to_document_freqs_.find(word);
+            return it == server_.word_to_document_freqs_.end() ? 0 : it->second.size();
+        }
+
+        const IndexedDocument& GetDocument(int document_id) const {
+            return server_.documents_.at(document_id);
+        }
+
+        template <typename Callback>
+        void ForEachPosting(std::string_view word, Callback callback) const {
+            const auto& document_freqs = server_.word_to_document_freqs_.find(word)->second;
+            server_.metrics_.AddPostingsScanned(document_freqs.size());
+            for (const auto& [document_id, term_freq] : document_freqs) {
+                if (!callback(document_id, term_freq)) {
+                    break;
+                }
+            }
+        }
+
+        template <typename Callback>
+        void ForEachDocument(Callback callback) const {
+            for (const auto& [document_id, document] : server_.documents_) {
+                if (!callback(document_id, document)) {
+                    break;
+                }
+            }
+        }
+
+    private:
+        const SearchServer& server_;
+    };
+
+    // A posting of a batch: document_index is the position of the document in documents_
+    struct BatchPosting {
+        uint32_t document_index;
+        double contribution;
     };
 
-    struct QueryWord {
-        std::string data;
-        bool is_minus;
-        bool is_stop;
-    };        
+    // Non-stop words of a quoted phrase with their offsets inside the phrase;
+    // stop words are skipped but still advance the offset.
+    struct Phrase {
+        explicit Phrase(std::pmr::memory_resource* resource)
+            : words(resource) {}
 
+        std::pmr::vector<std::pair<std::string_view, uint32_t>> words;
+    };
+
+    // Words view the raw query or, for expanded words, the index; containers
+    // take memory from the query arena.
     struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+        explicit Query(std::pmr::memory_resource* resource)
+            : plus_words(resource), minus_words(resource), phrases(resource) {}
+
+        std::pmr::set<std::string_view> plus_words;
+        std::pmr::set<std::string_view> minus_words;
+        std::pmr::vector<Phrase> phrases;
     };
     
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> id_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> document_ids_;    
-
-    bool IsStopWord(const std::string& word) const;
-    static bool IsValidWord(const std::string& word);
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    const std::set<std::string, std::less<>> stop_words_;
+    const SearchServerOptions options_;
+    std::map<std::string, std::map<int, TermFrequency>, std::less<>> word_to_document_freqs_;
+    std::map<int, std::map<std::string_view, TermFrequency>> id_to_word_freqs_;
+    std::map<std::string_view, WordPositions> word_to_document_positions_;
+    // words that currently have postings
+    TermDictionary dictionary_;
+    std::map<int, IndexedDocument> documents_;
+    std::vector<int> document_ids_;
+    uint64_t total_word_count_ = 0;
+    mutable QueryMetrics metrics_;
+
+    bool IsStopWord(std::string_view word) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
-    QueryWord ParseQueryWord(const std::string& text) const;
-    Query ParseQuery(const std::string& text) const;
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
-
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
-
-    template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const;
+    // Inserts word, or the indexed words a wildcard or fuzzy word stands for
+    void ExpandQueryWord(std::string_view word, bool is_minus, std::pmr::set<std::string_view>& words) const;
+    void ParsePhrase(std::string_view text, Query& query) const;
+    Query ParseQuery(std::string_view text, std::pmr::memory_resource* resource) const;
+    double GetAverageDocumentLength() const;
+    std::vector<uint32_t> GetWordPositions(std::string_view word, int document_id) const;
+    bool ContainsPhrase(int document_id, const Phrase& phrase) const;
+    double ComputeProximityBoost(int document_id, const Query& query) const;
+    bool NeedsPositionalRanking(const Query& query) const;
+    // Drops documents missing a phrase of the query and applies proximity ranking
+    void ApplyPositionalRanking(const Query& query, std::pmr::map<int, double>& document_to_relevance) const;
+    // Checks should_stop() before every document. Once it turns true, sets is_stopped,
+    // drops the documents not yet checked against the phrases, since they may not
+    // contain them, and leaves the rest without the proximity boost.
+    template <typename StopPredicate>
+    void ApplyPositionalRanking(const Query& query, std::pmr::map<int, double>& document_to_relevance,
+                                StopPredicate should_stop, bool& is_stopped) const;
+
+    // is_included[i] tells whether the i-th document of documents_ may be returned
+    std::vector<std::vector<Document>> ScoreQueryBatch(const std::vector<std::string>& raw_queries,
+                                                       const std::vector<char>& is_included) const;
+    // Scores queries [query_begin, query_end) from one copy of the postings of their words
+    void ScoreQueryGroup(const std::vector<Query>& queries, const std::vector<QueryPlan>& plans,
+                         size_t query_begin, size_t query_end,
+                         const std::map<std::string_view, double>& word_to_inverse_document_freq,
+                         const std::vector<int>& document_ids, const std::vector<int>& document_ratings,
+                         const std::vector<char>& is_included, std::vector<std::vector<Document>>& results) const;
+
+    // Transient structures, including the returned vector, live in resource.
+    template <typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, const ScoringModel& scoring,
+                                                DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource* resource) const;
+
+    // Sets is_stopped and returns what was scored so far once should_stop() turns true
+    template <typename ScoringModel, typename DocumentPredicate, typename StopPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, const ScoringModel& scoring,
+                                                DocumentPredicate document_predicate,
+                                                StopPredicate should_stop, bool& is_stopped,
+                                                std::pmr::memory_resource* resource) const;
+
+    template <typename ExecutionPolicy, typename ScoringModel, typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, const ScoringModel& scoring,
+                                                DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource* resource) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
+SearchServer::SearchServer(const StringContainer& stop_words, const SearchServerOptions& options)
     : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+    , options_(options)
 {
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid"s);
     }
+    if (options_.proximity_ranking && !options_.store_positions) {
+        throw std::invalid_argument("Proximity ranking requires store_positions"s);
+    }
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query.data());
+    return FindTopDocuments(TfIdfScoring{}, raw_query, document_predicate);
+}
 
-    auto matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
+template <typename ScoringModel, typename DocumentPredicate, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SearchServer::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query,
+                                                     DocumentPredicate document_predicate) const {
+    QueryArena arena;
+    StageTimer total_timer(metrics_, QueryStage::TOTAL);
+    StageTimer parse_timer(metrics_, QueryStage::PARSE);
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    parse_timer.Stop();
 
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            }
-            return lhs.relevance > rhs.relevance;
+    auto matched_documents = FindAllDocuments(query, scoring, document_predicate, arena.GetResource());
+
+    StageTimer sort_timer(metrics_, QueryStage::SORT);
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename ScoringModel, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SearchServer::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query,
+                                                     DocumentStatus status) const {
+    return FindTopDocuments(
+        scoring, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
         });
+}
+
+template <typename ScoringModel, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SearchServer::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query) const {
+    return FindTopDocuments(scoring, raw_query, DocumentStatus::ACTUAL);
+}
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename DocumentPredicate>
+std::future<AsyncSearchResult> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate,
+                                                                   SearchControl control, QueryExecutor& executor) const {
+    return executor.Submit([this, raw_query = std::move(raw_query), document_predicate, control] {
+        AsyncSearchResult result;
+        if (control.ShouldStop()) {
+            result.is_partial = true;
+            return result;
+        }
+        QueryArena arena;
+        StageTimer total_timer(metrics_, QueryStage::TOTAL);
+        StageTimer parse_timer(metrics_, QueryStage::PARSE);
+        const auto query = ParseQuery(raw_query, arena.GetResource());
+        parse_timer.Stop();
+
+        auto matched_documents = FindAllDocuments(query, TfIdfScoring{}, document_predicate,
+            [&control] { return control.ShouldStop(); }, result.is_partial, arena.GetResource());
+
+        StageTimer sort_timer(metrics_, QueryStage::SORT);
+        result.documents = SelectTopDocuments(matched_documents);
+        return result;
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                                       DocumentPredicate document_predicate) const {
+    std::vector<char> is_included;
+    is_included.reserve(documents_.size());
+    for (const auto& [document_id, document_data] : documents_) {
+        is_included.push_back(document_predicate(document_id, document_data.status, document_data.rating));
     }
+    return ScoreQueryBatch(raw_queries, is_included);
+}
 
-    return matched_documents;
+template <typename DocumentPredicate>
+RankedDocuments SearchServer::FindRankedDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    QueryArena arena;
+    StageTimer total_timer(metrics_, QueryStage::TOTAL);
+    StageTimer parse_timer(metrics_, QueryStage::PARSE);
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    parse_timer.Stop();
+
+    const auto matched_documents = FindAllDocuments(query, TfIdfScoring{}, document_predicate, arena.GetResource());
+    return RankedDocuments(std::vector<Document>(matched_documents.begin(), matched_documents.end()));
 }
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
+template <typename ExecutionPolicy, typename DocumentPredicate, EnableForExecutionPolicy<ExecutionPolicy>>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
         return FindTopDocuments(raw_query, document_predicate);
     }
-    const auto query = ParseQuery(raw_query.data());
+    QueryArena arena;
+    StageTimer total_timer(metrics_, QueryStage::TOTAL);
+    StageTimer parse_timer(metrics_, QueryStage::PARSE);
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    parse_timer.Stop();
 
-    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
+    auto matched_documents = FindAllDocuments(std::execution::par, query, TfIdfScoring{}, document_predicate, arena.GetResource());
 
-    sort(policy, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            }
-            return lhs.relevance > rhs.relevance;
-        });
+    StageTimer sort_timer(metrics_, QueryStage::SORT);
+    const size_t result_count = std::min<size_t>(matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    partial_sort(policy, matched_documents.begin(), matched_documents.begin() + result_count, matched_documents.end(),
+        IsRankedHigher);
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-
-    return matched_documents;
+    return std::vector<Document>(matched_documents.begin(), matched_documents.begin() + result_count);
 
 }
 
-template <typename ExecutionPolicy>
+template <typename ExecutionPolicy, EnableForExecutionPolicy<ExecutionPolicy>>
 std::vector<Document>  SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query, DocumentStatus status) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
         return FindTopDocuments(raw_query, status);
@@ -171,7 +455,7 @@ std::vector<Document>  SearchServer::FindTopDocuments(const ExecutionPolicy& pol
         });
 }
 
-template <typename ExecutionPolicy>
+template <typename ExecutionPolicy, EnableForExecutionPolicy<ExecutionPolicy>>
 std::vector<Document>  SearchServer::FindTopDocuments(const ExecutionPolicy& policy, std::string_view raw_query) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
         return FindTopDocuments(raw_query);
@@ -180,89 +464,118 @@ std::vector<Document>  SearchServer::FindTopDocuments(const ExecutionPolicy& pol
 
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-
-    for (const std::string& word : query.plus_words) {
-        auto it = word_to_document_freqs_.find(word);
-        if (it != word_to_document_freqs_.end()) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);  
-                      
-            for (const auto& [document_id, term_freq] : it->second) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
-                }
-            }
-        }
-    }
+template <typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, const ScoringModel& scoring,
+                                                          DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource* resource) const {
+    bool is_stopped = false;
+    return FindAllDocuments(query, scoring, document_predicate, [] { return false; }, is_stopped, resource);
+}
 
-    for (const std::string& word : query.minus_words) {
-        auto it = word_to_document_freqs_.find(word);
-        if (it != word_to_document_freqs_.end()) {
-            for (const auto &[document_id, _] : it->second) {
-                document_to_relevance.erase(document_id);
-            }
-        }
+template <typename ScoringModel, typename DocumentPredicate, typename StopPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, const ScoringModel& scoring,
+                                                          DocumentPredicate document_predicate,
+                                                          StopPredicate should_stop, bool& is_stopped,
+                                                          std::pmr::memory_resource* resource) const {
+    StageTimer score_timer(metrics_, QueryStage::SCORE);
+    const IndexView index(*this);
+    const QueryPlan plan = PlanQuery(index, query.plus_words, query.minus_words, scoring, resource);
+    if (plan.scored_terms.empty() && !plan.matches_all_documents) {
+        return std::pmr::vector<Document>(resource);
     }
-
-    std::vector<Document> matched_documents;
+    std::pmr::map<int, double> document_to_relevance(resource);
+    ScoreDocuments(index, plan, scoring, document_predicate, should_stop, is_stopped, document_to_relevance);
+    score_timer.Stop();
+
+    StageTimer merge_timer(metrics_, QueryStage::MERGE);
+    ApplyPositionalRanking(query, document_to_relevance, should_stop, is_stopped);
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(document_to_relevance.size());
     for (const auto &[document_id, relevance] : document_to_relevance) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
+    metrics_.AddDocumentsMatched(matched_documents.size());
 
     return matched_documents;
 }
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const {
-    if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return FindAllDocuments(query, document_predicate);
+template <typename StopPredicate>
+void SearchServer::ApplyPositionalRanking(const Query& query, std::pmr::map<int, double>& document_to_relevance,
+                                          StopPredicate should_stop, bool& is_stopped) const {
+    for (const Phrase& phrase : query.phrases) {
+        for (auto it = document_to_relevance.begin(); it != document_to_relevance.end();) {
+            if (is_stopped || should_stop()) {
+                is_stopped = true;
+                it = document_to_relevance.erase(it);
+            } else {
+                it = ContainsPhrase(it->first, phrase) ? std::next(it) : document_to_relevance.erase(it);
+            }
+        }
     }
-    ConcurrentMap<int, double> document_to_relevance(document_ids_.size());
-
-    for_each (policy, query.plus_words.begin(), query.plus_words.end(), [&](const auto& word) {
-        auto it = word_to_document_freqs_.find(word);
-        if (it != word_to_document_freqs_.end()) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-
-            /*for (const auto& [document_id, term_freq] : it->second) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
-                }
-            }*/
-            
-            for_each (std::execution::par, it->second.begin(), it->second.end(), [&] (const auto& pair) {
-                int document_id = pair.first;
-                double term_freq = pair.second;
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
-                }
-            });
+    if (options_.proximity_ranking && query.plus_words.size() > 1) {
+        for (auto& [document_id, relevance] : document_to_relevance) {
+            if (is_stopped || should_stop()) {
+                is_stopped = true;
+                break;
+            }
+            relevance *= ComputeProximityBoost(document_id, query);
         }
-    });
+    }
+}
 
-    for_each (policy, query.minus_words.begin(), query.minus_words.end(), [&](const auto& word) {
-        auto it = word_to_document_freqs_.find(word);
-        if (it != word_to_document_freqs_.end()) {
-            /*for (const auto &[document_id, _] : it->second) {
-                document_to_relevance.erase(document_id);
-            }*/
-
-            for_each (std::execution::par, it->second.begin(), it->second.end(), [&](const auto& pair) {
-                int document_id = pair.first;
-                document_to_relevance.erase(document_id);
-            });
-        }
-    });
+template <typename ExecutionPolicy, typename ScoringModel, typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, const ScoringModel& scoring,
+                                                          DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource* resource) const {
+    if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        return FindAllDocuments(query, scoring, document_predicate, resource);
+    }
+    StageTimer score_timer(metrics_, QueryStage::SCORE);
+    const IndexView index(*this);
+    const QueryPlan plan = PlanQuery(index, query.plus_words, query.minus_words, scoring, resource);
+    if (plan.scored_terms.empty() && !plan.matches_all_documents) {
+        return std::pmr::vector<Document>(resource);
+    }
+    const auto excluded_documents = CollectExcludedDocuments(index, plan, resource);
+    auto is_included = [&](int document_id, const IndexedDocument& document_data) {
+        return !std::binary_search(excluded_documents.begin(), excluded_documents.end(), document_id)
+            && document_predicate(document_id, document_data.status, document_data.rating);
+    };
+    // the workers fill the map concurrently, the arena itself is single-threaded
+    SynchronizedResource shared_resource(resource);
+    ConcurrentMap<int, double> document_to_relevance(
+        std::clamp<size_t>(document_ids_.size(), 1, MAX_RELEVANCE_BUCKET_COUNT), &shared_resource);
+
+    if (plan.matches_all_documents) {
+        for_each (policy, document_ids_.begin(), document_ids_.end(), [&](int document_id) {
+            if (is_included(document_id, documents_.at(document_id))) {
+                document_to_relevance[document_id] += 0.0;
+            }
+        });
+    }
 
-    std::vector<Document> matched_documents;
-    for (const auto &[document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+    const auto scorer = scoring.CreateScorer(GetAverageDocumentLength());
+    for_each (policy, plan.scored_terms.begin(), plan.scored_terms.end(), [&](const QueryPlanTerm& term) {
+        const auto& document_freqs = word_to_document_freqs_.find(term.word)->second;
+        metrics_.AddPostingsScanned(document_freqs.size());
+        for_each (std::execution::par, document_freqs.begin(), document_freqs.end(), [&] (const auto& pair) {
+            const auto& document_data = documents_.at(pair.first);
+            if (is_included(pair.first, document_data)) {
+                document_to_relevance[pair.first] += scorer(pair.second, term.inverse_document_freq, document_data.word_count);
+            }
+        });
+    });
+    score_timer.Stop();
+
+    StageTimer merge_timer(metrics_, QueryStage::MERGE);
+    auto ordinary_document_to_relevance = document_to_relevance.BuildOrdinaryMap(resource);
+    ApplyPositionalRanking(query, ordinary_document_to_relevance);
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(ordinary_document_to_relevance.size());
+    for (const auto &[document_id, relevance] : ordinary_document_to_relevance) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
+    metrics_.AddDocumentsMatched(matched_documents.size());
 
     return matched_documents;
 }
@@ -276,13 +589,14 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     if (id_to_word_freqs_.find(document_id) == id_to_word_freqs_.end()) {
         throw std::out_of_range("Invalid document id"s);
     }
-    const auto query = ParseQuery(raw_query.data());
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
 
     std::vector<std::string_view> matched_words;
     for_each (policy, query.plus_words.begin(), query.plus_words.end(), [&](const auto& word) {
         auto it = word_to_document_freqs_.find(word);
         if (it != word_to_document_freqs_.end() && it->second.find(document_id) != it->second.end()) {
-            matched_words.push_back(word);
+            matched_words.push_back(it->first);
         }
     });
 
@@ -293,6 +607,12 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
         }
     });
 
+    for (const Phrase& phrase : query.phrases) {
+        if (!ContainsPhrase(document_id, phrase)) {
+            matched_words.clear();
+        }
+    }
+
     return {matched_words, documents_.at(document_id).status};
 }
 
@@ -306,9 +626,18 @@ void SearchServer::RemoveDocument(const ExecutionPolicy& policy, int document_id
         
         for_each (policy, it->second.begin(), it->second.end(), [&](const auto& word_to_id) {
             word_to_document_freqs_.at(word_to_id.first.data()).erase(document_id);
+            if (options_.store_positions) {
+                word_to_document_positions_.at(word_to_id.first).Erase(document_id);
+            }
         });
+        for (const auto& [word, _] : it->second) {
+            if (word_to_document_freqs_.find(word)->second.empty()) {
+                dictionary_.Erase(word);
+            }
+        }
 
         id_to_word_freqs_.erase(document_id);
+        total_word_count_ -= documents_.at(document_id).word_count;
         documents_.erase(document_id);
 
         auto iterator = find(policy, begin(), end(), document_id);
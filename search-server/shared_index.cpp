@@ -0,0 +1,452 @@
+#include "shared_index.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const uint64_t SHARED_INDEX_MAGIC = 0x3258444E49535353;  // "SSSINDX2"
+
+struct SharedIndexControl {
+    atomic<uint64_t> generation;
+    // set by Unlink just before the segment is unlinked
+    atomic<uint64_t> is_unlinked;
+};
+
+static_assert(atomic<uint64_t>::is_always_lock_free, "generation counter must be usable across processes");
+
+[[noreturn]] void ThrowSystemError(const string& action, const string& name) {
+    throw runtime_error(action + " "s + name + ": "s + strerror(errno));
+}
+
+string GetSegmentName(const string& name, uint64_t generation) {
+    return name + "."s + to_string(generation);
+}
+
+size_t Align(size_t offset) {
+    const size_t alignment = alignof(max_align_t);
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+SharedIndexSnapshot::SharedIndexSnapshot(const string& name, uint64_t generation) {
+    const string segment_name = GetSegmentName(name, generation);
+    const int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        ThrowSystemError("Cannot open shared index"s, segment_name);
+    }
+    struct stat segment_stat;
+    if (fstat(fd, &segment_stat) != 0) {
+        close(fd);
+        ThrowSystemError("Cannot stat shared index"s, segment_name);
+    }
+    size_ = static_cast<size_t>(segment_stat.st_size);
+    void* data = size_ >= sizeof(SharedIndexHeader) ? mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        ThrowSystemError("Cannot map shared index"s, segment_name);
+    }
+    data_ = static_cast<const char*>(data);
+    header_ = reinterpret_cast<const SharedIndexHeader*>(data_);
+    if (header_->magic != SHARED_INDEX_MAGIC || header_->generation != generation || header_->size != size_) {
+        munmap(const_cast<char*>(data_), size_);
+        throw runtime_error("Shared index "s + segment_name + " is corrupted"s);
+    }
+}
+
+SharedIndexSnapshot::~SharedIndexSnapshot() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+uint64_t SharedIndexSnapshot::GetGeneration() const {
+    return header_->generation;
+}
+
+int SharedIndexSnapshot::GetDocumentCount() const {
+    return static_cast<int>(header_->document_count);
+}
+
+vector<Document> SharedIndexSnapshot::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(
+        raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+vector<Document> SharedIndexSnapshot::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+string_view SharedIndexSnapshot::GetString(const SharedString& string) const {
+    return {data_ + string.offset, static_cast<size_t>(string.length)};
+}
+
+const SharedDocument* SharedIndexSnapshot::GetDocuments() const {
+    return reinterpret_cast<const SharedDocument*>(data_ + header_->documents_offset);
+}
+
+const SharedDocument* SharedIndexSnapshot::FindDocument(int document_id) const {
+    const SharedDocument* documents = GetDocuments();
+    return lower_bound(documents, documents + header_->document_count, document_id,
+        [](const SharedDocument& document, int id) { return document.id < id; });
+}
+
+const SharedTerm* SharedIndexSnapshot::FindTerm(string_view word) const {
+    const SharedTerm* terms = reinterpret_cast<const SharedTerm*>(data_ + header_->terms_offset);
+    const SharedTerm* terms_end = terms + header_->term_count;
+    const SharedTerm* it = lower_bound(terms, terms_end, word, [this](const SharedTerm& term, string_view value) {
+        return GetString(term.word) < value;
+    });
+    return it != terms_end && GetString(it->word) == word ? it : nullptr;
+}
+
+const SharedPosting* SharedIndexSnapshot::GetPostings(const SharedTerm& term) const {
+    return reinterpret_cast<const SharedPosting*>(data_ + header_->postings_offset) + term.first_posting;
+}
+
+bool SharedIndexSnapshot::IsStopWord(string_view word) const {
+    const SharedString* stop_words = reinterpret_cast<const SharedString*>(data_ + header_->stop_words_offset);
+    const SharedString* stop_words_end = stop_words + header_->stop_word_count;
+    const SharedString* it = lower_bound(stop_words, stop_words_end, word, [this](const SharedString& stop_word, string_view value) {
+        return GetString(stop_word) < value;
+    });
+    return it != stop_words_end && GetString(*it) == word;
+}
+
+// Same rules as SearchServer::ParseQuery without phrases and term expansion
+SharedIndexSnapshot::Query SharedIndexSnapshot::ParseQuery(string_view text) const {
+    Query result;
+    ForEachQueryToken(
+        text,
+        [this, &result](const QueryToken& token) {
+            if (IsStopWord(token.word)) {
+                return;
+            }
+            if (token.word.find('*') != string_view::npos || FindFuzzySuffix(token.word) != string_view::npos) {
+                throw invalid_argument("Wildcard and fuzzy words are not supported by the shared index"s);
+            }
+            (token.is_minus ? result.minus_words : result.plus_words).push_back(token.word);
+        },
+        [](string_view) {
+            throw invalid_argument("Phrase queries are not supported by the shared index"s);
+        });
+    for (auto* words : {&result.plus_words, &result.minus_words}) {
+        sort(words->begin(), words->end());
+        words->erase(unique(words->begin(), words->end()), words->end());
+    }
+    return result;
+}
+
+double SharedIndexSnapshot::IndexView::GetAverageDocumentLength() const {
+    const SharedIndexHeader& header = *snapshot_.header_;
+    return header.document_count == 0 ? 0.0
+        : static_cast<double>(header.total_word_count) / static_cast<double>(header.document_count);
+}
+
+size_t SharedIndexSnapshot::IndexView::GetWordDocumentCount(string_view word) const {
+    const SharedTerm* term = snapshot_.FindTerm(word);
+    return term == nullptr ? 0 : static_cast<size_t>(term->posting_count);
+}
+
+IndexedDocument SharedIndexSnapshot::IndexView::GetDocument(int document_id) const {
+    return ToIndexedDocument(*snapshot_.FindDocument(document_id));
+}
+
+IndexedDocument SharedIndexSnapshot::IndexView::ToIndexedDocument(const SharedDocument& document) {
+    return {document.rating, static_cast<DocumentStatus>(document.status), document.word_count};
+}
+
+class SharedIndexReader::Control {
+public:
+    explicit Control(const string& name) {
+        fd_ = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd_ < 0) {
+            ThrowSystemError("Cannot open shared index"s, name);
+        }
+        struct stat control_stat;
+        if (fstat(fd_, &control_stat) != 0 || static_cast<size_t>(control_stat.st_size) < sizeof(SharedIndexControl)) {
+            close(fd_);
+            throw runtime_error("Shared index "s + name + " has no control segment"s);
+        }
+        device_ = control_stat.st_dev;
+        inode_ = control_stat.st_ino;
+        void* control = mmap(nullptr, sizeof(SharedIndexControl), PROT_READ, MAP_SHARED, fd_, 0);
+        if (control == MAP_FAILED) {
+            close(fd_);
+            ThrowSystemError("Cannot map shared index"s, name);
+        }
+        control_ = static_cast<const SharedIndexControl*>(control);
+    }
+
+    Control(const Control&) = delete;
+    Control& operator=(const Control&) = delete;
+
+    ~Control() {
+        munmap(const_cast<SharedIndexControl*>(control_), sizeof(SharedIndexControl));
+        close(fd_);
+    }
+
+    uint64_t LoadGeneration() const {
+        return control_->generation.load(memory_order_acquire);
+    }
+
+    bool IsUnlinked() const {
+        return control_->is_unlinked.load(memory_order_acquire) != 0;
+    }
+
+    bool IsSameSegment(const Control& other) const {
+        return device_ == other.device_ && inode_ == other.inode_;
+    }
+
+private:
+    int fd_ = -1;
+    const SharedIndexControl* control_ = nullptr;
+    dev_t device_ = 0;
+    ino_t inode_ = 0;
+};
+
+SharedIndexReader::SharedIndexReader(string name)
+    : name_(move(name))
+    , control_(make_shared<const Control>(name_))
+{
+}
+
+SharedIndexReader::~SharedIndexReader() = default;
+
+shared_ptr<const SharedIndexSnapshot> SharedIndexReader::GetSnapshot() {
+    // control_ is replaced after snapshot_, so a snapshot read after the control
+    // always belongs to that control or to a newer one
+    auto control = atomic_load(&control_);
+    auto snapshot = atomic_load(&snapshot_);
+    if (!control->IsUnlinked() && snapshot && snapshot->GetGeneration() == control->LoadGeneration()) {
+        return snapshot;
+    }
+
+    lock_guard guard(mutex_);
+    control = control_;
+    snapshot = snapshot_;
+    if (control->IsUnlinked()) {
+        if (auto reopened = ReopenControl(*control)) {
+            snapshot = LoadSnapshot(*reopened);
+            atomic_store(&snapshot_, snapshot);
+            atomic_store(&control_, move(reopened));
+            return snapshot;
+        }
+        if (snapshot) {
+            // nothing has been published since; keep serving the last index
+            return snapshot;
+        }
+    }
+    if (snapshot && snapshot->GetGeneration() == control->LoadGeneration()) {
+        return snapshot;
+    }
+    try {
+        snapshot = LoadSnapshot(*control);
+    } catch (const runtime_error&) {
+        // the segment may have been removed without Unlink, e.g. by hand
+        auto reopened = ReopenControl(*control);
+        if (!reopened) {
+            throw;
+        }
+        snapshot = LoadSnapshot(*reopened);
+        atomic_store(&snapshot_, snapshot);
+        atomic_store(&control_, move(reopened));
+        return snapshot;
+    }
+    atomic_store(&snapshot_, snapshot);
+    return snapshot;
+}
+
+shared_ptr<const SharedIndexReader::Control> SharedIndexReader::ReopenControl(const Control& current) const {
+    try {
+        auto control = make_shared<const Control>(name_);
+        if (!control->IsSameSegment(current) && control->LoadGeneration() > 0) {
+            return control;
+        }
+    } catch (const runtime_error&) {
+        // not created again yet
+    }
+    return nullptr;
+}
+
+shared_ptr<const SharedIndexSnapshot> SharedIndexReader::LoadSnapshot(const Control& control) const {
+    // The publisher unlinks a generation once the next one is current, so a
+    // reader that lost the race simply retries with the newer number.
+    uint64_t generation = control.LoadGeneration();
+    const int max_attempts = 16;
+    for (int attempt = 1;; ++attempt) {
+        if (generation == 0) {
+            throw runtime_error("Shared index "s + name_ + " has not been published yet"s);
+        }
+        try {
+            return make_shared<const SharedIndexSnapshot>(name_, generation);
+        } catch (const runtime_error&) {
+            const uint64_t published = control.LoadGeneration();
+            if (published == generation || attempt == max_attempts) {
+                throw;
+            }
+            generation = published;
+        }
+    }
+}
+
+vector<Document> SharedIndexReader::FindTopDocuments(string_view raw_query) {
+    return GetSnapshot()->FindTopDocuments(raw_query);
+}
+
+SharedIndexPublisher::SharedIndexPublisher(string name)
+    : name_(move(name))
+{
+    if (name_.size() < 2 || name_[0] != '/' || name_.find('/', 1) != string::npos) {
+        throw invalid_argument("Shared index name "s + name_ + " must look like /name"s);
+    }
+    control_fd_ = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+    if (control_fd_ < 0) {
+        ThrowSystemError("Cannot create shared index"s, name_);
+    }
+    struct stat control_stat;
+    const bool is_new = fstat(control_fd_, &control_stat) == 0 && control_stat.st_size == 0;
+    if (is_new && ftruncate(control_fd_, sizeof(SharedIndexControl)) != 0) {
+        close(control_fd_);
+        ThrowSystemError("Cannot resize shared index"s, name_);
+    }
+    control_ = mmap(nullptr, sizeof(SharedIndexControl), PROT_READ | PROT_WRITE, MAP_SHARED, control_fd_, 0);
+    if (control_ == MAP_FAILED) {
+        close(control_fd_);
+        ThrowSystemError("Cannot map shared index"s, name_);
+    }
+    auto* control = static_cast<SharedIndexControl*>(control_);
+    if (is_new) {
+        new (control) SharedIndexControl{{0}, {0}};
+    }
+    // continue numbering after a previous publisher so readers never see a generation twice
+    generation_ = control->generation.load(memory_order_acquire);
+}
+
+SharedIndexPublisher::~SharedIndexPublisher() {
+    munmap(control_, sizeof(SharedIndexControl));
+    close(control_fd_);
+}
+
+void SharedIndexPublisher::Unlink() {
+    if (is_unlinked_) {
+        return;
+    }
+    is_unlinked_ = true;
+    static_cast<SharedIndexControl*>(control_)->is_unlinked.store(1, memory_order_release);
+    if (generation_ > 0) {
+        shm_unlink(GetSegmentName(name_, generation_).c_str());
+    }
+    shm_unlink(name_.c_str());
+}
+
+uint64_t SharedIndexPublisher::Publish(const SearchServer& search_server) {
+    if (is_unlinked_) {
+        throw logic_error("Shared index "s + name_ + " was unlinked by this publisher"s);
+    }
+    const uint64_t generation = generation_ + 1;
+    const SearchServer::IndexExport index = search_server.ExportIndex();
+
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    size_t strings_size = 0;
+    for (const auto& [word, document_freqs] : index.word_to_document_freqs) {
+        if (!document_freqs.empty()) {
+            ++term_count;
+            posting_count += document_freqs.size();
+            strings_size += word.size();
+        }
+    }
+    for (const string& stop_word : index.stop_words) {
+        strings_size += stop_word.size();
+    }
+    uint64_t total_word_count = 0;
+    for (const auto& [document_id, document] : index.documents) {
+        total_word_count += static_cast<uint64_t>(document.word_count);
+    }
+
+    SharedIndexHeader header{};
+    header.magic = SHARED_INDEX_MAGIC;
+    header.generation = generation;
+    header.document_count = static_cast<uint32_t>(index.documents.size());
+    header.term_count = static_cast<uint32_t>(term_count);
+    header.stop_word_count = static_cast<uint32_t>(index.stop_words.size());
+    header.total_word_count = total_word_count;
+    header.documents_offset = Align(sizeof(SharedIndexHeader));
+    header.terms_offset = Align(header.documents_offset + header.document_count * sizeof(SharedDocument));
+    header.postings_offset = Align(header.terms_offset + term_count * sizeof(SharedTerm));
+    header.stop_words_offset = Align(header.postings_offset + posting_count * sizeof(SharedPosting));
+    const size_t strings_offset = Align(header.stop_words_offset + header.stop_word_count * sizeof(SharedString));
+    header.size = max<size_t>(strings_offset + strings_size, 1);
+
+    const string segment_name = GetSegmentName(name_, generation);
+    shm_unlink(segment_name.c_str());
+    const int fd = shm_open(segment_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        ThrowSystemError("Cannot create shared index"s, segment_name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(header.size)) != 0) {
+        close(fd);
+        shm_unlink(segment_name.c_str());
+        ThrowSystemError("Cannot resize shared index"s, segment_name);
+    }
+    void* mapping = mmap(nullptr, header.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(segment_name.c_str());
+        ThrowSystemError("Cannot map shared index"s, segment_name);
+    }
+    char* data = static_cast<char*>(mapping);
+
+    size_t string_end = strings_offset;
+    auto write_string = [data, &string_end](string_view text) {
+        memcpy(data + string_end, text.data(), text.size());
+        const SharedString result{string_end, text.size()};
+        string_end += text.size();
+        return result;
+    };
+
+    auto* documents = reinterpret_cast<SharedDocument*>(data + header.documents_offset);
+    for (const auto& [document_id, document] : index.documents) {
+        *documents++ = {document_id, document.rating, static_cast<int32_t>(document.status), document.word_count};
+    }
+
+    auto* terms = reinterpret_cast<SharedTerm*>(data + header.terms_offset);
+    auto* postings = reinterpret_cast<SharedPosting*>(data + header.postings_offset);
+    uint64_t posting_index = 0;
+    for (const auto& [word, document_freqs] : index.word_to_document_freqs) {
+        if (document_freqs.empty()) {
+            continue;
+        }
+        *terms++ = {write_string(word), posting_index, document_freqs.size()};
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            postings[posting_index++] = {document_id, 0, term_freq};
+        }
+    }
+
+    auto* stop_words = reinterpret_cast<SharedString*>(data + header.stop_words_offset);
+    for (const string& stop_word : index.stop_words) {
+        *stop_words++ = write_string(stop_word);
+    }
+
+    memcpy(data, &header, sizeof(header));
+    munmap(mapping, header.size);
+
+    static_cast<SharedIndexControl*>(control_)->generation.store(generation, memory_order_release);
+    if (generation_ > 0) {
+        // readers that already mapped the old generation keep it until they drop it
+        shm_unlink(GetSegmentName(name_, generation_).c_str());
+    }
+    generation_ = generation;
+    return generation;
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "document.h"
+#include "query_arena.h"
+#include "query_scoring.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only copy of a SearchServer index in POSIX shared memory, meant for
+// several query processes on one host. The index is published in generations:
+// segment "<name>.<generation>" holds one flat, offset-addressed copy of the
+// dictionary, postings and document table, and control segment "<name>" holds
+// the number of the current generation. Readers switch to a newer generation
+// on their next query; queries already running keep the old mapping.
+// The index outlives the publisher process: a restarted publisher continues
+// the numbering, and only SharedIndexPublisher::Unlink removes the index.
+
+// Plain data laid out in the segment; every offset is relative to the segment start.
+struct SharedIndexHeader {
+    uint64_t magic;
+    uint64_t generation;
+    uint64_t size;
+    uint32_t document_count;
+    uint32_t term_count;
+    uint32_t stop_word_count;
+    uint32_t reserved;
+    uint64_t total_word_count;   // sum of document word counts, for BM25
+    uint64_t documents_offset;   // SharedDocument[document_count], ascending id
+    uint64_t terms_offset;       // SharedTerm[term_count], ascending word
+    uint64_t postings_offset;    // SharedPosting[], grouped by term, ascending document id
+    uint64_t stop_words_offset;  // SharedString[stop_word_count]
+};
+
+struct SharedDocument {
+    int32_t id;
+    int32_t rating;
+    int32_t status;
+    int32_t word_count;
+};
+
+struct SharedString {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct SharedTerm {
+    SharedString word;
+    uint64_t first_posting;
+    uint64_t posting_count;
+};
+
+struct SharedPosting {
+    int32_t document_id;
+    int32_t reserved;
+    double term_freq;
+};
+
+// One mapped generation. Queries are parsed, planned and scored by the same code
+// as in SearchServer; quoted phrases are not supported because positions are
+// not published, and neither are wildcard and fuzzy words, which need the term
+// dictionary.
+class SharedIndexSnapshot {
+public:
+    SharedIndexSnapshot(const std::string& name, uint64_t generation);
+    SharedIndexSnapshot(const SharedIndexSnapshot&) = delete;
+    SharedIndexSnapshot& operator=(const SharedIndexSnapshot&) = delete;
+    ~SharedIndexSnapshot();
+
+    uint64_t GetGeneration() const;
+    int GetDocumentCount() const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ScoringModel, typename DocumentPredicate, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename ScoringModel, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename ScoringModel, EnableForScoringModel<ScoringModel> = true>
+    std::vector<Document> FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query) const;
+
+private:
+    // Unique words in ascending order
+    struct Query {
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+    };
+
+    // The Index of query_scoring.h over the mapped segment
+    class IndexView {
+    public:
+        explicit IndexView(const SharedIndexSnapshot& snapshot)
+            : snapshot_(snapshot) {}
+
+        int GetDocumentCount() const {
+            return snapshot_.GetDocumentCount();
+        }
+
+        double GetAverageDocumentLength() const;
+        size_t GetWordDocumentCount(std::string_view word) const;
+        IndexedDocument GetDocument(int document_id) const;
+
+        template <typename Callback>
+        void ForEachPosting(std::string_view word, Callback callback) const {
+            const SharedTerm& term = *snapshot_.FindTerm(word);
+            const SharedPosting* postings = snapshot_.GetPostings(term);
+            for (uint64_t i = 0; i < term.posting_count; ++i) {
+                if (!callback(postings[i].document_id, postings[i].term_freq)) {
+                    break;
+                }
+            }
+        }
+
+        template <typename Callback>
+        void ForEachDocument(Callback callback) const {
+            const SharedDocument* documents = snapshot_.GetDocuments();
+            for (uint32_t i = 0; i < snapshot_.header_->document_count; ++i) {
+                if (!callback(documents[i].id, ToIndexedDocument(documents[i]))) {
+                    break;
+                }
+            }
+        }
+
+    private:
+        const SharedIndexSnapshot& snapshot_;
+
+        static IndexedDocument ToIndexedDocument(const SharedDocument& document);
+    };
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const SharedIndexHeader* header_ = nullptr;
+
+    std::string_view GetString(const SharedString& string) const;
+    const SharedDocument* GetDocuments() const;
+    const SharedDocument* FindDocument(int document_id) const;
+    const SharedTerm* FindTerm(std::string_view word) const;
+    const SharedPosting* GetPostings(const SharedTerm& term) const;
+    bool IsStopWord(std::string_view word) const;
+    Query ParseQuery(std::string_view text) const;
+};
+
+// Re-opens the control segment by name once the old one is unlinked, so it also
+// follows an index that was removed and published again from scratch.
+class SharedIndexReader {
+public:
+    explicit SharedIndexReader(std::string name);
+    SharedIndexReader(const SharedIndexReader&) = delete;
+    SharedIndexReader& operator=(const SharedIndexReader&) = delete;
+    ~SharedIndexReader();
+
+    // The newest published generation; hold the pointer to keep querying one consistent index.
+    std::shared_ptr<const SharedIndexSnapshot> GetSnapshot();
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+private:
+    class Control;
+
+    std::string name_;
+    std::mutex mutex_;
+    // snapshot_ is always a generation of control_; both change under mutex_
+    std::shared_ptr<const Control> control_;
+    std::shared_ptr<const SharedIndexSnapshot> snapshot_;
+
+    // A newly created control segment with a published generation, or nullptr
+    std::shared_ptr<const Control> ReopenControl(const Control& current) const;
+    std::shared_ptr<const SharedIndexSnapshot> LoadSnapshot(const Control& control) const;
+};
+
+class SharedIndexPublisher {
+public:
+    // name must start with '/' and contain no other slashes, see shm_open(3)
+    explicit SharedIndexPublisher(std::string name);
+    SharedIndexPublisher(const SharedIndexPublisher&) = delete;
+    SharedIndexPublisher& operator=(const SharedIndexPublisher&) = delete;
+    // Leaves the control and the current segments in place for readers and for
+    // the next publisher
+    ~SharedIndexPublisher();
+
+    // Writes a new generation and makes it current; returns its number.
+    // Throws logic_error after Unlink: the control segment is no longer reachable
+    // by name, so no reader could see the generation.
+    uint64_t Publish(const SearchServer& search_server);
+
+    // Removes the index: tells attached readers the control segment is gone and
+    // unlinks it together with the current generation. Readers keep answering
+    // from their last snapshot until a new publisher with this name publishes
+    // again. Later calls do nothing, so they never remove that new index.
+    void Unlink();
+
+private:
+    std::string name_;
+    int control_fd_ = -1;
+    void* control_ = nullptr;
+    uint64_t generation_ = 0;
+    bool is_unlinked_ = false;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SharedIndexSnapshot::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(TfIdfScoring{}, raw_query, document_predicate);
+}
+
+template <typename ScoringModel, typename DocumentPredicate, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SharedIndexSnapshot::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query,
+                                                            DocumentPredicate document_predicate) const {
+    QueryArena arena;
+    const Query query = ParseQuery(raw_query);
+    const IndexView index(*this);
+    const QueryPlan plan = PlanQuery(index, query.plus_words, query.minus_words, scoring, arena.GetResource());
+    std::pmr::map<int, double> document_to_relevance(arena.GetResource());
+    bool is_stopped = false;
+    ScoreDocuments(index, plan, scoring, document_predicate, [] { return false; }, is_stopped, document_to_relevance);
+
+    std::pmr::vector<Document> matched_documents(arena.GetResource());
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto& [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({document_id, relevance, FindDocument(document_id)->rating});
+    }
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename ScoringModel, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SharedIndexSnapshot::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query,
+                                                            DocumentStatus status) const {
+    return FindTopDocuments(
+        scoring, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        });
+}
+
+template <typename ScoringModel, EnableForScoringModel<ScoringModel>>
+std::vector<Document> SharedIndexSnapshot::FindTopDocuments(const ScoringModel& scoring, std::string_view raw_query) const {
+    return FindTopDocuments(scoring, raw_query, DocumentStatus::ACTUAL);
+}
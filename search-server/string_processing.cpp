@@ -1,5 +1,7 @@
 #include "string_processing.h"
 
+#include <algorithm>
+
 using namespace std;
 
 vector<string> SplitIntoWords(const string& text) {
@@ -20,4 +22,40 @@ vector<string> SplitIntoWords(const string& text) {
     }
 
     return words;
-}
\ No newline at end of file
+}
+
+vector<string_view> SplitIntoWordViews(string_view text) {
+    vector<string_view> words;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t begin = text.find_first_not_of(' ', pos);
+        if (begin == string_view::npos) {
+            break;
+        }
+        const size_t end = min(text.find(' ', begin), text.size());
+        words.push_back(text.substr(begin, end - begin));
+        pos = end;
+    }
+    return words;
+}
+
+bool IsValidWord(string_view word) {
+    return none_of(word.begin(), word.end(), [](char c) {
+        return c >= '\0' && c < ' ';
+    });
+}
+
+QueryToken ParseQueryToken(string_view text) {
+    if (text.empty()) {
+        throw invalid_argument("Query word is empty"s);
+    }
+    QueryToken token{text, false};
+    if (token.word[0] == '-') {
+        token.is_minus = true;
+        token.word.remove_prefix(1);
+    }
+    if (token.word.empty() || token.word[0] == '-' || !IsValidWord(token.word)) {
+        throw invalid_argument("Query word "s + string(text) + " is invalid"s);
+    }
+    return token;
+}
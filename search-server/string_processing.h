@@ -1,13 +1,61 @@
 #pragma once
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <set>
 #include <vector>
 
 std::vector<std::string> SplitIntoWords(const std::string& text);
 
+// Same splitting rules as SplitIntoWords, but the words view the original text.
+std::vector<std::string_view> SplitIntoWordViews(std::string_view text);
+
+// Control characters are not allowed in document, stop and query words.
+bool IsValidWord(std::string_view word);
+
+struct QueryToken {
+    std::string_view word;
+    bool is_minus = false;
+};
+
+// Strips the '-' of a minus word. Throws invalid_argument if the rest is empty,
+// starts with another '-' or is not a valid word.
+QueryToken ParseQueryToken(std::string_view text);
+
+// Calls on_word(QueryToken) for every query word outside quotes and
+// on_phrase(text) with the text between the quotes of every phrase.
+// Throws invalid_argument for a minus phrase or an unterminated quote.
+template <typename WordCallback, typename PhraseCallback>
+void ForEachQueryToken(std::string_view text, WordCallback on_word, PhraseCallback on_phrase) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (text[pos] == ' ') {
+            ++pos;
+            continue;
+        }
+        if (text[pos] == '-' && pos + 1 < text.size() && text[pos + 1] == '"') {
+            throw std::invalid_argument("Minus phrases are not supported");
+        }
+        if (text[pos] == '"') {
+            const size_t phrase_end = text.find('"', pos + 1);
+            if (phrase_end == std::string_view::npos) {
+                throw std::invalid_argument("Query " + std::string(text) + " has an unterminated phrase");
+            }
+            on_phrase(text.substr(pos + 1, phrase_end - pos - 1));
+            pos = phrase_end + 1;
+            continue;
+        }
+        const size_t word_end = std::min(text.find(' ', pos), text.size());
+        on_word(ParseQueryToken(text.substr(pos, word_end - pos)));
+        pos = word_end;
+    }
+}
+
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
         if (!str.empty()) {
             non_empty_strings.insert(str);
@@ -0,0 +1,258 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+const uint32_t ROOT = 0;
+
+bool IsLabelLess(char lhs, char rhs) {
+    return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs);
+}
+
+// Adds the positions reachable through '*' without reading a character
+void CloseStates(string_view pattern, vector<char>& states) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (states[i] && pattern[i] == '*') {
+            states[i + 1] = true;
+        }
+    }
+}
+
+} // namespace
+
+TermDictionary::TermDictionary()
+    : nodes_(1)
+{
+}
+
+bool TermDictionary::Insert(string_view word) {
+    if (Contains(word)) {
+        return false;
+    }
+    uint32_t node = ROOT;
+    ++nodes_[node].subtree_word_count;
+    for (const char label : word) {
+        // the new child goes after the last sibling with a smaller label
+        uint32_t previous = NO_NODE;
+        uint32_t child = nodes_[node].first_child;
+        while (child != NO_NODE && IsLabelLess(nodes_[child].label, label)) {
+            previous = child;
+            child = nodes_[child].next_sibling;
+        }
+        if (child == NO_NODE || nodes_[child].label != label) {
+            Node new_child;
+            new_child.label = label;
+            new_child.next_sibling = child;
+            child = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(new_child);
+            (previous == NO_NODE ? nodes_[node].first_child : nodes_[previous].next_sibling) = child;
+        }
+        node = child;
+        ++nodes_[node].subtree_word_count;
+    }
+    nodes_[node].is_word = true;
+    return true;
+}
+
+bool TermDictionary::Erase(string_view word) {
+    if (!Contains(word)) {
+        return false;
+    }
+    uint32_t node = ROOT;
+    --nodes_[node].subtree_word_count;
+    for (const char label : word) {
+        node = FindChild(node, label);
+        --nodes_[node].subtree_word_count;
+    }
+    nodes_[node].is_word = false;
+    return true;
+}
+
+bool TermDictionary::Contains(string_view word) const {
+    const uint32_t node = FindNode(word);
+    return node != NO_NODE && nodes_[node].is_word;
+}
+
+TermDictionary::Lookup TermDictionary::FindByPrefix(string_view prefix, size_t max_count, size_t max_visited_nodes) const {
+    Search search{string(prefix), max_count, max_visited_nodes, {}};
+    const uint32_t node = FindNode(prefix);
+    if (node != NO_NODE && max_count > 0) {
+        CollectWords(node, search);
+    }
+    return search.result;
+}
+
+TermDictionary::Lookup TermDictionary::FindByPattern(string_view pattern, size_t max_count, size_t max_visited_nodes) const {
+    Search search{{}, max_count, max_visited_nodes, {}};
+    // the literal part before the first '*' is looked up directly
+    const size_t literal_size = min(pattern.find('*'), pattern.size());
+    search.path = string(pattern.substr(0, literal_size));
+    pattern.remove_prefix(literal_size);
+    const uint32_t node = FindNode(search.path);
+    if (node == NO_NODE || max_count == 0) {
+        return {};
+    }
+    vector<vector<char>> states(1, vector<char>(pattern.size() + 1, false));
+    states[0][0] = true;
+    CloseStates(pattern, states[0]);
+    MatchPattern(node, pattern, states, search);
+    return search.result;
+}
+
+vector<string> TermDictionary::FindSimilar(string_view word, int max_distance, size_t max_count) const {
+    Search search{{}, max_count, numeric_limits<size_t>::max(), {}};
+    vector<vector<int>> rows(1, vector<int>(word.size() + 1));
+    for (size_t i = 0; i <= word.size(); ++i) {
+        rows[0][i] = static_cast<int>(i);
+    }
+    // one pass per distance, so a capped result keeps the closest words
+    for (int distance = 0; distance <= max_distance && search.result.words.size() < max_count; ++distance) {
+        MatchSimilar(ROOT, word, distance, rows, search);
+    }
+    return search.result.words;
+}
+
+size_t TermDictionary::GetWordCount() const {
+    return nodes_[ROOT].subtree_word_count;
+}
+
+size_t TermDictionary::GetByteSize() const {
+    return nodes_.capacity() * sizeof(Node);
+}
+
+bool TermDictionary::Search::Visit() {
+    if (visits_left == 0) {
+        result.is_truncated = true;
+        return false;
+    }
+    --visits_left;
+    return true;
+}
+
+uint32_t TermDictionary::FindChild(uint32_t node, char label) const {
+    uint32_t child = nodes_[node].first_child;
+    while (child != NO_NODE && IsLabelLess(nodes_[child].label, label)) {
+        child = nodes_[child].next_sibling;
+    }
+    return child != NO_NODE && nodes_[child].label == label ? child : NO_NODE;
+}
+
+uint32_t TermDictionary::FindNode(string_view word) const {
+    uint32_t node = ROOT;
+    for (const char label : word) {
+        node = FindChild(node, label);
+        if (node == NO_NODE) {
+            break;
+        }
+    }
+    return node;
+}
+
+void TermDictionary::CollectWords(uint32_t node, Search& search) const {
+    if (nodes_[node].is_word) {
+        search.result.words.push_back(search.path);
+    }
+    for (uint32_t child = nodes_[node].first_child; child != NO_NODE; child = nodes_[child].next_sibling) {
+        if (search.result.words.size() >= search.max_count || !search.Visit()) {
+            return;
+        }
+        if (nodes_[child].subtree_word_count == 0) {
+            continue;
+        }
+        search.path.push_back(nodes_[child].label);
+        CollectWords(child, search);
+        search.path.pop_back();
+    }
+}
+
+// states.back() holds the pattern positions reached by the current path;
+// a deeper level is added per character, like running an NFA along the trie.
+void TermDictionary::MatchPattern(uint32_t node, string_view pattern, vector<vector<char>>& states, Search& search) const {
+    const size_t depth = states.size() - 1;
+    if (nodes_[node].is_word && states[depth][pattern.size()]) {
+        search.result.words.push_back(search.path);
+    }
+    states.emplace_back(pattern.size() + 1);
+    for (uint32_t child = nodes_[node].first_child; child != NO_NODE; child = nodes_[child].next_sibling) {
+        if (search.result.words.size() >= search.max_count || !search.Visit()) {
+            break;
+        }
+        if (nodes_[child].subtree_word_count == 0) {
+            continue;
+        }
+        const char label = nodes_[child].label;
+        vector<char>& next = states[depth + 1];
+        fill(next.begin(), next.end(), false);
+        bool is_alive = false;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (!states[depth][i]) {
+                continue;
+            }
+            if (pattern[i] == '*') {
+                next[i] = true;
+                is_alive = true;
+            } else if (pattern[i] == label) {
+                next[i + 1] = true;
+                is_alive = true;
+            }
+        }
+        if (!is_alive) {
+            continue;
+        }
+        CloseStates(pattern, next);
+        search.path.push_back(label);
+        MatchPattern(child, pattern, states, search);
+        search.path.pop_back();
+    }
+    states.pop_back();
+}
+
+// rows.back() is the edit distance row between the current path and every
+// prefix of word; branches whose whole row exceeds distance are cut off.
+void TermDictionary::MatchSimilar(uint32_t node, string_view word, int distance,
+                                  vector<vector<int>>& rows, Search& search) const {
+    const size_t depth = rows.size() - 1;
+    if (nodes_[node].is_word && rows[depth][word.size()] == distance) {
+        search.result.words.push_back(search.path);
+    }
+    rows.emplace_back(word.size() + 1);
+    for (uint32_t child = nodes_[node].first_child; child != NO_NODE; child = nodes_[child].next_sibling) {
+        if (search.result.words.size() >= search.max_count || !search.Visit()) {
+            break;
+        }
+        if (nodes_[child].subtree_word_count == 0) {
+            continue;
+        }
+        const char label = nodes_[child].label;
+        const vector<int>& row = rows[depth];
+        vector<int>& next = rows[depth + 1];
+        next[0] = row[0] + 1;
+        int row_min = next[0];
+        for (size_t i = 1; i <= word.size(); ++i) {
+            next[i] = min({row[i] + 1, next[i - 1] + 1, row[i - 1] + (word[i - 1] == label ? 0 : 1)});
+            row_min = min(row_min, next[i]);
+        }
+        if (row_min > distance) {
+            continue;
+        }
+        search.path.push_back(label);
+        MatchSimilar(child, word, distance, rows, search);
+        search.path.pop_back();
+    }
+    rows.pop_back();
+}
+
+size_t FindFuzzySuffix(string_view word) {
+    const size_t tilde = word.rfind('~');
+    if (tilde == 0 || tilde == string_view::npos) {
+        return string_view::npos;
+    }
+    const bool is_fuzzy = all_of(word.begin() + tilde + 1, word.end(), [](char c) {
+        return c >= '0' && c <= '9';
+    });
+    return is_fuzzy ? tilde : string_view::npos;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Trie over the indexed words for prefix, wildcard and fuzzy term expansion.
+// Nodes live in one flat vector and link their first child and next sibling by
+// index, so a node takes 16 bytes and walking the trie never chases heap pointers.
+// Siblings are kept sorted, so every lookup returns words in lexicographic order.
+class TermDictionary {
+public:
+    TermDictionary();
+
+    // Returns false if the word was already present.
+    bool Insert(std::string_view word);
+    // Returns false if the word was absent. Nodes are kept for reuse.
+    bool Erase(std::string_view word);
+    bool Contains(std::string_view word) const;
+
+    struct Lookup {
+        std::vector<std::string> words;
+        // Set when the lookup ran out of visited nodes; more words may match.
+        bool is_truncated = false;
+    };
+
+    // Prefix and pattern lookups stop after max_count words or after examining
+    // max_visited_nodes trie nodes, so a pattern that matches few words, like
+    // "*zzq", cannot walk the whole trie looking for them.
+    Lookup FindByPrefix(std::string_view prefix, size_t max_count, size_t max_visited_nodes) const;
+    // '*' in pattern matches any, possibly empty, sequence of characters.
+    Lookup FindByPattern(std::string_view pattern, size_t max_count, size_t max_visited_nodes) const;
+    // Words within max_distance Levenshtein edits of word, closest first; stops
+    // after max_count words. Branches beyond the distance are cut off, which
+    // bounds the walk without a node budget.
+    std::vector<std::string> FindSimilar(std::string_view word, int max_distance, size_t max_count) const;
+
+    size_t GetWordCount() const;
+    size_t GetByteSize() const;
+
+private:
+    static const uint32_t NO_NODE = UINT32_MAX;
+
+    struct Node {
+        uint32_t first_child = NO_NODE;
+        uint32_t next_sibling = NO_NODE;
+        uint32_t subtree_word_count = 0;  // lets lookups skip branches left by erased words
+        char label = '\0';
+        bool is_word = false;
+    };
+
+    struct Search {
+        std::string path;
+        size_t max_count;
+        size_t visits_left;
+        Lookup result;
+
+        // Whether the walk may go on to one more node
+        bool Visit();
+    };
+
+    std::vector<Node> nodes_;
+
+    uint32_t FindChild(uint32_t node, char label) const;
+    uint32_t FindNode(std::string_view word) const;
+    void CollectWords(uint32_t node, Search& search) const;
+    void MatchPattern(uint32_t node, std::string_view pattern, std::vector<std::vector<char>>& states, Search& search) const;
+    void MatchSimilar(uint32_t node, std::string_view word, int distance,
+                      std::vector<std::vector<int>>& rows, Search& search) const;
+};
+
+// Position of '~' in a fuzzy query word such as "cat~" or "cat~2", npos otherwise.
+size_t FindFuzzySuffix(std::string_view word);
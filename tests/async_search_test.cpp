@@ -0,0 +1,63 @@
+#include "query_executor.h"
+#include "search_server.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+int failure_count = 0;
+
+void Check(bool condition, const string& description) {
+    if (!condition) {
+        cerr << "FAILED: "s << description << endl;
+        ++failure_count;
+    }
+}
+
+// Runs the query and returns its result with the time it took
+pair<AsyncSearchResult, chrono::steady_clock::duration> RunTimed(const SearchServer& server, const string& raw_query,
+                                                                 chrono::microseconds timeout, QueryExecutor& executor) {
+    SearchControl control;
+    const auto start = chrono::steady_clock::now();
+    if (timeout.count() > 0) {
+        control.deadline = start + timeout;
+    }
+    AsyncSearchResult result = server.FindTopDocumentsAsync(raw_query, control, executor).get();
+    return {move(result), chrono::steady_clock::now() - start};
+}
+
+void TestDeadlineDuringMinusWords() {
+    // every document holds the minus words, so reading them is most of the query
+    SearchServer server(""s);
+    const int document_count = 200000;
+    for (int id = 0; id < document_count; ++id) {
+        server.AddDocument(id, id % 100 == 0 ? "c0 c1 c2 c3 w1"s : "c0 c1 c2 c3"s, DocumentStatus::ACTUAL, {1});
+    }
+    QueryExecutor executor(1);
+    const string raw_query = "w1 -c0 -c1 -c2 -c3"s;
+
+    const auto [full, full_time] = RunTimed(server, raw_query, chrono::microseconds(0), executor);
+    Check(!full.is_partial && full.documents.empty(), "query without a deadline excludes every document"s);
+
+    const auto [stopped, stopped_time] = RunTimed(server, raw_query, chrono::microseconds(200), executor);
+    Check(stopped.is_partial, "deadline during the minus words marks the result partial"s);
+    Check(stopped.documents.empty(), "nothing is scored against an incomplete exclusion set"s);
+    Check(stopped_time * 4 < full_time, "deadline stops the query while it reads the minus words"s);
+}
+
+} // namespace
+
+int main() {
+    TestDeadlineDuringMinusWords();
+    if (failure_count > 0) {
+        cerr << failure_count << " check(s) failed"s << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "async_search_test OK"s << endl;
+    return EXIT_SUCCESS;
+}
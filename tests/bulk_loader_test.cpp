@@ -0,0 +1,176 @@
+#include "bulk_loader.h"
+#include "search_server.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+int failure_count = 0;
+
+void Check(bool condition, const string& description) {
+    if (!condition) {
+        cerr << "FAILED: "s << description << endl;
+        ++failure_count;
+    }
+}
+
+string WriteInput(const string& content) {
+    const string path = (filesystem::temp_directory_path() / "search_server_bulk_loader_test.txt"s).string();
+    ofstream out(path, ios::binary);
+    out << content;
+    return path;
+}
+
+SearchServer Load(const string& content, InputFormat format) {
+    SearchServer server(""s);
+    BulkLoadOptions options;
+    options.format = format;
+    options.worker_count = 2;
+    const string path = WriteInput(content);
+    try {
+        LoadDocuments(server, path, options);
+    } catch (...) {
+        filesystem::remove(path);
+        throw;
+    }
+    filesystem::remove(path);
+    return server;
+}
+
+bool IsRejected(const string& content, InputFormat format) {
+    try {
+        Load(content, format);
+    } catch (const invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+vector<string> GetWords(const SearchServer& server, int document_id) {
+    vector<string> words;
+    for (const auto& [word, _] : server.GetWordFrequencies(document_id)) {
+        words.emplace_back(word);
+    }
+    return words;
+}
+
+void TestTsv() {
+    const SearchServer server = Load("1\tACTUAL\t1 2 3\tcat dog\n2\t2\t\tbird\n"s, InputFormat::TSV);
+    Check(server.GetDocumentCount() == 2, "TSV loads every line"s);
+    Check(GetWords(server, 1) == vector<string>{"cat"s, "dog"s}, "TSV text is split into words"s);
+    Check(server.FindTopDocuments("bird"s, DocumentStatus::BANNED).size() == 1, "TSV numeric status"s);
+    Check(server.FindTopDocuments("cat"s).at(0).rating == 2, "TSV ratings are averaged"s);
+
+    Check(IsRejected("1\tACTUAL\tcat dog\n"s, InputFormat::TSV), "TSV line with a missing field"s);
+    Check(IsRejected("x\tACTUAL\t1\tcat\n"s, InputFormat::TSV), "TSV non-numeric id"s);
+    Check(IsRejected("1\tACTUAL\t1 y\tcat\n"s, InputFormat::TSV), "TSV non-numeric rating"s);
+    Check(IsRejected("1\tOLD\t1\tcat\n"s, InputFormat::TSV), "TSV unknown status name"s);
+    Check(IsRejected("1\t9\t1\tcat\n"s, InputFormat::TSV), "TSV out-of-range status"s);
+}
+
+void TestCrlf() {
+    const SearchServer tsv = Load("1\tACTUAL\t1\tcat dog\r\n2\tACTUAL\t1\tbird\r\n"s, InputFormat::TSV);
+    Check(GetWords(tsv, 1) == vector<string>{"cat"s, "dog"s}, "CRLF is not part of the last TSV word"s);
+    Check(tsv.GetDocumentCount() == 2, "TSV with CRLF loads every line"s);
+
+    const SearchServer json = Load("{\"id\": 1, \"text\": \"cat\"}\r\n\r\n{\"id\": 2, \"text\": \"dog\"}\r\n"s,
+                                   InputFormat::JSONL);
+    Check(json.GetDocumentCount() == 2, "JSONL with CRLF and an empty line loads every object"s);
+}
+
+void TestJson() {
+    const SearchServer server = Load(
+        "{\"id\": 1, \"status\": \"BANNED\", \"ratings\": [1, -3], \"text\": \"cat dog\"}\n"
+        "{ \"text\" : \"bird\" , \"id\" : 2 , \"status\" : 1 }\n"s,
+        InputFormat::JSONL);
+    Check(server.GetDocumentCount() == 2, "JSONL loads every object"s);
+    Check(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).at(0).rating == -1, "JSONL status and ratings"s);
+    Check(server.FindTopDocuments("bird"s, DocumentStatus::IRRELEVANT).size() == 1, "JSONL numeric status"s);
+
+    Check(IsRejected("{\"id\": 1, \"status\": 9, \"text\": \"cat\"}\n"s, InputFormat::JSONL), "JSONL out-of-range status"s);
+    Check(IsRejected("{\"id\": 1, \"status\": -1, \"text\": \"cat\"}\n"s, InputFormat::JSONL), "JSONL negative status"s);
+    Check(IsRejected("{\"id\": 1}\n"s, InputFormat::JSONL), "JSONL object without text"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"cat\", \"lang\": \"en\"}\n"s, InputFormat::JSONL), "JSONL unknown key"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"cat\"} x\n"s, InputFormat::JSONL), "JSONL trailing characters"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"cat}\n"s, InputFormat::JSONL), "JSONL unterminated string"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"cat\"\n"s, InputFormat::JSONL), "JSONL unterminated object"s);
+}
+
+void TestJsonEscapes() {
+    const SearchServer server = Load(
+        "{\"id\": 1, \"text\": \"a\\nb\\tc \\\"q\\\" back\\\\slash s\\/lash\"}\n"
+        "{\"id\": 2, \"text\": \"caf\\u00e9 \\u20ac \\uD83D\\uDE00\"}\n"s,
+        InputFormat::JSONL);
+    Check(GetWords(server, 1) == vector<string>{"\"q\""s, "a"s, "b"s, "back\\slash"s, "c"s, "s/lash"s},
+          "JSON escapes: control characters split words, quotes and slashes are kept"s);
+    Check(GetWords(server, 2) == vector<string>{"caf\xC3\xA9"s, "\xE2\x82\xAC"s, "\xF0\x9F\x98\x80"s},
+          "JSON \\u escapes and surrogate pairs become UTF-8"s);
+
+    Check(IsRejected("{\"id\": 1, \"text\": \"\\uD83D\"}\n"s, InputFormat::JSONL), "JSON lone high surrogate"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"\\uD83Dx\"}\n"s, InputFormat::JSONL), "JSON high surrogate before a letter"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"\\uDE00\"}\n"s, InputFormat::JSONL), "JSON lone low surrogate"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"\\u00g1\"}\n"s, InputFormat::JSONL), "JSON invalid \\u digits"s);
+    Check(IsRejected("{\"id\": 1, \"text\": \"\\u00\"}\n"s, InputFormat::JSONL), "JSON truncated \\u escape"s);
+}
+
+// Message of the invalid_argument thrown for content, or "" if it loads
+string GetLoadError(const string& content, InputFormat format) {
+    try {
+        Load(content, format);
+    } catch (const invalid_argument& e) {
+        return e.what();
+    }
+    return {};
+}
+
+void TestStatusErrorOffset() {
+    const string tsv_error = GetLoadError("1\tACTUAL\t1\tcat\n2\tOLD\t1\tdog\n"s, InputFormat::TSV);
+    Check(tsv_error.find("byte 15"s) != string::npos && tsv_error.find("unknown status OLD"s) != string::npos,
+          "TSV unknown status is reported with its byte offset"s);
+
+    const string json_error = GetLoadError("{\"id\": 1, \"text\": \"cat\"}\n{\"id\": 2, \"status\": 7, \"text\": \"dog\"}\n"s,
+                                           InputFormat::JSONL);
+    Check(json_error.find("byte 25"s) != string::npos && json_error.find("unknown status 7"s) != string::npos,
+          "JSONL unknown status is reported with its byte offset"s);
+}
+
+void TestDocumentsBeforeErrorStay() {
+    SearchServer server(""s);
+    const string path = WriteInput("1\tACTUAL\t1\tcat\n2\tACTUAL\tcat\n"s);
+    BulkLoadOptions options;
+    options.chunk_size = 1;
+    bool is_rejected = false;
+    try {
+        LoadDocuments(server, path, options);
+    } catch (const invalid_argument& e) {
+        is_rejected = string(e.what()).find("byte 15"s) != string::npos;
+    }
+    filesystem::remove(path);
+    Check(is_rejected, "malformed line is reported with its byte offset"s);
+    Check(server.GetDocumentCount() == 1, "documents before the malformed line stay indexed"s);
+}
+
+} // namespace
+
+int main() {
+    TestTsv();
+    TestCrlf();
+    TestJson();
+    TestJsonEscapes();
+    TestStatusErrorOffset();
+    TestDocumentsBeforeErrorStay();
+    if (failure_count > 0) {
+        cerr << failure_count << " check(s) failed"s << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "bulk_loader_test OK"s << endl;
+    return EXIT_SUCCESS;
+}